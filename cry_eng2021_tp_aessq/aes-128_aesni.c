@@ -0,0 +1,264 @@
+/*
+ * AES-128 Encryption and Decryption
+ * AES-NI backend, 8 independent blocks in flight
+ *
+ * AESENC / AESENCLAST use the same byte order as aes_round, so blocks and
+ * round keys are loaded as they are. A reduced last round without MixColumns
+ * is AESENCLAST, a full one is AESENC.
+ * AESDEC / AESDECLAST implement the equivalent inverse cipher and expect
+ * the middle round keys through AESIMC.
+ */
+
+#include "aes-128_backend.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define AESNI_LANES 8
+
+int aes128_aesni_available(void)
+{
+	unsigned eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+	{
+		return 0;
+	}
+	return (ecx & bit_AES) && (edx & bit_SSE2);
+}
+
+__attribute__((target("aes,sse2")))
+void aes128_aesni_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull)
+{
+	__m128i k[AES128_MAX_ROUNDS + 1];
+	__m128i s[AESNI_LANES];
+	unsigned r;
+	size_t n = 0;
+	int j;
+
+	for (r = 0; r <= nrounds; r++)
+	{
+		k[r] = _mm_loadu_si128((const __m128i *)ks->rk[r]);
+	}
+
+	/*
+	 * Full batches: AESENC has a multi-cycle latency but single-cycle
+	 * throughput, interleaving 8 blocks keeps the unit busy
+	 */
+	for (; n + AESNI_LANES <= nblocks; n += AESNI_LANES)
+	{
+		for (j = 0; j < AESNI_LANES; j++)
+		{
+			s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)blocks[n + j]), k[0]);
+		}
+		for (r = 1; r < nrounds; r++)
+		{
+			for (j = 0; j < AESNI_LANES; j++)
+			{
+				s[j] = _mm_aesenc_si128(s[j], k[r]);
+			}
+		}
+		for (j = 0; j < AESNI_LANES; j++)
+		{
+			s[j] = lastfull ? _mm_aesenc_si128(s[j], k[nrounds]) : _mm_aesenclast_si128(s[j], k[nrounds]);
+			_mm_storeu_si128((__m128i *)blocks[n + j], s[j]);
+		}
+	}
+
+	/*
+	 * Tail, one block at a time
+	 */
+	for (; n < nblocks; n++)
+	{
+		__m128i t = _mm_xor_si128(_mm_loadu_si128((const __m128i *)blocks[n]), k[0]);
+
+		for (r = 1; r < nrounds; r++)
+		{
+			t = _mm_aesenc_si128(t, k[r]);
+		}
+		t = lastfull ? _mm_aesenc_si128(t, k[nrounds]) : _mm_aesenclast_si128(t, k[nrounds]);
+		_mm_storeu_si128((__m128i *)blocks[n], t);
+	}
+}
+
+__attribute__((target("aes,sse2")))
+void aes128_aesni_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull)
+{
+	__m128i k[AES128_MAX_ROUNDS + 1];
+	__m128i s[AESNI_LANES];
+	unsigned r;
+	size_t n = 0;
+	int j;
+
+	for (r = 0; r <= nrounds; r++)
+	{
+		k[r] = _mm_loadu_si128((const __m128i *)ks->rk[r]);
+		if (r > 0 && r < nrounds)
+		{
+			k[r] = _mm_aesimc_si128(k[r]);
+		}
+	}
+
+	/*
+	 * A full last round is undone by AESIMC right after its AddRoundKey
+	 */
+	for (; n + AESNI_LANES <= nblocks; n += AESNI_LANES)
+	{
+		for (j = 0; j < AESNI_LANES; j++)
+		{
+			s[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)blocks[n + j]), k[nrounds]);
+			if (lastfull)
+			{
+				s[j] = _mm_aesimc_si128(s[j]);
+			}
+		}
+		for (r = nrounds - 1; r >= 1; r--)
+		{
+			for (j = 0; j < AESNI_LANES; j++)
+			{
+				s[j] = _mm_aesdec_si128(s[j], k[r]);
+			}
+		}
+		for (j = 0; j < AESNI_LANES; j++)
+		{
+			s[j] = _mm_aesdeclast_si128(s[j], k[0]);
+			_mm_storeu_si128((__m128i *)blocks[n + j], s[j]);
+		}
+	}
+
+	/*
+	 * Tail, one block at a time
+	 */
+	for (; n < nblocks; n++)
+	{
+		__m128i t = _mm_xor_si128(_mm_loadu_si128((const __m128i *)blocks[n]), k[nrounds]);
+
+		if (lastfull)
+		{
+			t = _mm_aesimc_si128(t);
+		}
+		for (r = nrounds - 1; r >= 1; r--)
+		{
+			t = _mm_aesdec_si128(t, k[r]);
+		}
+		t = _mm_aesdeclast_si128(t, k[0]);
+		_mm_storeu_si128((__m128i *)blocks[n], t);
+	}
+}
+
+/*
+ * F: AESNI_LANES / 2 inputs, each encrypted under both keys, so the same
+ * 8 independent AESENC chains are in flight
+ */
+__attribute__((target("aes,sse2")))
+void aes128_aesni_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                         size_t nblocks, const aes128_key_schedule_t *ks1,
+                         const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	__m128i k1[AES128_MAX_ROUNDS + 1];
+	__m128i k2[AES128_MAX_ROUNDS + 1];
+	__m128i s[AESNI_LANES];
+	unsigned r;
+	size_t n = 0;
+	int j;
+
+	for (r = 0; r <= nrounds; r++)
+	{
+		k1[r] = _mm_loadu_si128((const __m128i *)ks1->rk[r]);
+		k2[r] = _mm_loadu_si128((const __m128i *)ks2->rk[r]);
+	}
+
+	/*
+	 * Lane 2j is input j under k1, lane 2j + 1 under k2
+	 */
+	for (; n + AESNI_LANES / 2 <= nblocks; n += AESNI_LANES / 2)
+	{
+		for (j = 0; j < AESNI_LANES / 2; j++)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i *)in[n + j]);
+
+			s[2 * j]     = _mm_xor_si128(x, k1[0]);
+			s[2 * j + 1] = _mm_xor_si128(x, k2[0]);
+		}
+		for (r = 1; r < nrounds; r++)
+		{
+			for (j = 0; j < AESNI_LANES / 2; j++)
+			{
+				s[2 * j]     = _mm_aesenc_si128(s[2 * j], k1[r]);
+				s[2 * j + 1] = _mm_aesenc_si128(s[2 * j + 1], k2[r]);
+			}
+		}
+		for (j = 0; j < AESNI_LANES / 2; j++)
+		{
+			if (lastfull)
+			{
+				s[2 * j]     = _mm_aesenc_si128(s[2 * j], k1[nrounds]);
+				s[2 * j + 1] = _mm_aesenc_si128(s[2 * j + 1], k2[nrounds]);
+			}
+			else
+			{
+				s[2 * j]     = _mm_aesenclast_si128(s[2 * j], k1[nrounds]);
+				s[2 * j + 1] = _mm_aesenclast_si128(s[2 * j + 1], k2[nrounds]);
+			}
+			_mm_storeu_si128((__m128i *)out[n + j], _mm_xor_si128(s[2 * j], s[2 * j + 1]));
+		}
+	}
+
+	/*
+	 * Tail, one input (two chains) at a time
+	 */
+	for (; n < nblocks; n++)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)in[n]);
+		__m128i t = _mm_xor_si128(x, k1[0]);
+		__m128i u = _mm_xor_si128(x, k2[0]);
+
+		for (r = 1; r < nrounds; r++)
+		{
+			t = _mm_aesenc_si128(t, k1[r]);
+			u = _mm_aesenc_si128(u, k2[r]);
+		}
+		t = lastfull ? _mm_aesenc_si128(t, k1[nrounds]) : _mm_aesenclast_si128(t, k1[nrounds]);
+		u = lastfull ? _mm_aesenc_si128(u, k2[nrounds]) : _mm_aesenclast_si128(u, k2[nrounds]);
+		_mm_storeu_si128((__m128i *)out[n], _mm_xor_si128(t, u));
+	}
+}
+
+#else
+
+int aes128_aesni_available(void)
+{
+	return 0;
+}
+
+void aes128_aesni_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull)
+{
+	/* Never selected: aes128_aesni_available() is false */
+	aes128_ttable_enc_many(blocks, nblocks, ks, nrounds, lastfull);
+}
+
+void aes128_aesni_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull)
+{
+	/* Never selected: aes128_aesni_available() is false */
+	aes128_ttable_dec_many(blocks, nblocks, ks, nrounds, lastfull);
+}
+
+void aes128_aesni_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                         size_t nblocks, const aes128_key_schedule_t *ks1,
+                         const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	/* Never selected: aes128_aesni_available() is false */
+	aes128_ttable_f_many(in, out, nblocks, ks1, ks2, nrounds, lastfull);
+}
+
+#endif
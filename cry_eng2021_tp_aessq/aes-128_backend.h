@@ -0,0 +1,71 @@
+#ifndef __AES_128_BACKEND__H__
+#define __AES_128_BACKEND__H__
+
+/*
+ * Internal interface between aes-128_engine.c and the cipher backends.
+ * Not part of the public API.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes-128_enc.h"
+
+/*
+ * Encrypt @nblocks blocks in place. @nrounds is already normalized to {1...10}.
+ */
+typedef void (*aes128_enc_many_fn)(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                                   const aes128_key_schedule_t *ks,
+                                   unsigned nrounds, int lastfull);
+
+/*
+ * Decrypt @nblocks blocks in place, inverse of aes128_enc_many_fn with the
+ * same key schedule and @nrounds / @lastfull
+ */
+typedef void (*aes128_dec_many_fn)(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                                   const aes128_key_schedule_t *ks,
+                                   unsigned nrounds, int lastfull);
+
+/*
+ * F(k1||k2, x) = E(k1, x) ^ E(k2, x) for @nblocks inputs of @in into @out,
+ * which may be @in. Same @nrounds / @lastfull contract.
+ */
+typedef void (*aes128_f_many_fn)(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                                 size_t nblocks, const aes128_key_schedule_t *ks1,
+                                 const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull);
+
+void aes128_ttable_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                            const aes128_key_schedule_t *ks,
+                            unsigned nrounds, int lastfull);
+
+void aes128_ttable_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                            const aes128_key_schedule_t *ks,
+                            unsigned nrounds, int lastfull);
+
+void aes128_ttable_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                          size_t nblocks, const aes128_key_schedule_t *ks1,
+                          const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull);
+
+void aes128_bitslice_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                              const aes128_key_schedule_t *ks,
+                              unsigned nrounds, int lastfull);
+
+void aes128_bitslice_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                              const aes128_key_schedule_t *ks,
+                              unsigned nrounds, int lastfull);
+
+/*
+ * AES-NI backend, only usable when aes128_aesni_available() is true
+ */
+int aes128_aesni_available(void);
+void aes128_aesni_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull);
+void aes128_aesni_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                           const aes128_key_schedule_t *ks,
+                           unsigned nrounds, int lastfull);
+void aes128_aesni_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                         size_t nblocks, const aes128_key_schedule_t *ks1,
+                         const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull);
+
+#endif // __AES_128_BACKEND__H__
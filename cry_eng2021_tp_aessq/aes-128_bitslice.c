@@ -0,0 +1,377 @@
+/*
+ * AES-128 Encryption and Decryption
+ * Bitsliced backend, AES128_BITSLICE_WIDTH blocks per pass
+ * Constant-time: no secret-dependent table lookups or branches
+ *
+ * The state is 128 slices: slice[8 * p + b] holds bit b of byte p for every
+ * block of the batch, one block per bit of the word.
+ * SubBytes is computed as x^254 in GF(2^8) followed by the affine map,
+ * InvSubBytes as the inverse affine map followed by x^254.
+ */
+
+#include <string.h>
+
+#include "aes-128_backend.h"
+
+#ifndef AES128_BITSLICE_WIDTH
+#define AES128_BITSLICE_WIDTH 32
+#endif
+
+#if AES128_BITSLICE_WIDTH == 8
+typedef uint8_t bs_word_t;
+#elif AES128_BITSLICE_WIDTH == 16
+typedef uint16_t bs_word_t;
+#elif AES128_BITSLICE_WIDTH == 32
+typedef uint32_t bs_word_t;
+#elif AES128_BITSLICE_WIDTH == 64
+typedef uint64_t bs_word_t;
+#else
+#error "AES128_BITSLICE_WIDTH must be 8, 16, 32 or 64"
+#endif
+
+#define BS_ONES ((bs_word_t)~(bs_word_t)0)
+
+/*
+ * Product of two bitsliced field elements, reduced by X^8 + X^4 + X^3 + X + 1
+ */
+static void bs_gf_mul(const bs_word_t a[8], const bs_word_t b[8], bs_word_t out[8])
+{
+	bs_word_t p[15] = {0};
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+	{
+		for (j = 0; j < 8; j++)
+		{
+			p[i + j] ^= a[i] & b[j];
+		}
+	}
+	/* X^k = X^(k-4) + X^(k-5) + X^(k-7) + X^(k-8) */
+	for (i = 14; i >= 8; i--)
+	{
+		p[i - 4] ^= p[i];
+		p[i - 5] ^= p[i];
+		p[i - 7] ^= p[i];
+		p[i - 8] ^= p[i];
+	}
+	memcpy(out, p, 8 * sizeof(bs_word_t));
+}
+
+/*
+ * Squaring is linear: spread the bits to the even powers, then reduce
+ */
+static void bs_gf_sqr(const bs_word_t a[8], bs_word_t out[8])
+{
+	bs_word_t p[15] = {0};
+	int i;
+
+	for (i = 0; i < 8; i++)
+	{
+		p[2 * i] = a[i];
+	}
+	for (i = 14; i >= 8; i--)
+	{
+		p[i - 4] ^= p[i];
+		p[i - 5] ^= p[i];
+		p[i - 7] ^= p[i];
+		p[i - 8] ^= p[i];
+	}
+	memcpy(out, p, 8 * sizeof(bs_word_t));
+}
+
+/*
+ * x^254, the field inverse (0 for 0)
+ */
+static void bs_gf_inv(const bs_word_t x[8], bs_word_t t[8])
+{
+	bs_word_t x2[8], x3[8], x12[8], x15[8];
+
+	bs_gf_sqr(x, x2);
+	bs_gf_mul(x2, x, x3);
+	bs_gf_sqr(x3, t);
+	bs_gf_sqr(t, x12);
+	bs_gf_mul(x12, x3, x15);
+	bs_gf_sqr(x15, t);        /* x^30 */
+	bs_gf_sqr(t, t);          /* x^60 */
+	bs_gf_sqr(t, t);          /* x^120 */
+	bs_gf_sqr(t, t);          /* x^240 */
+	bs_gf_mul(t, x12, t);     /* x^252 */
+	bs_gf_mul(t, x2, t);      /* x^254 */
+}
+
+/*
+ * S(x) = A * x^254 + 0x63
+ */
+static void bs_sbox(bs_word_t x[8])
+{
+	bs_word_t t[8];
+	int i;
+
+	bs_gf_inv(x, t);
+	for (i = 0; i < 8; i++)
+	{
+		x[i] = t[i] ^ t[(i + 4) & 7] ^ t[(i + 5) & 7] ^ t[(i + 6) & 7] ^ t[(i + 7) & 7];
+	}
+	/* 0x63 */
+	x[0] ^= BS_ONES;
+	x[1] ^= BS_ONES;
+	x[5] ^= BS_ONES;
+	x[6] ^= BS_ONES;
+}
+
+/*
+ * Sinv(x) = (A^-1 * x + 0x05)^254
+ */
+static void bs_inv_sbox(bs_word_t x[8])
+{
+	bs_word_t t[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+	{
+		t[i] = x[(i + 2) & 7] ^ x[(i + 5) & 7] ^ x[(i + 7) & 7];
+	}
+	/* 0x05 */
+	t[0] ^= BS_ONES;
+	t[2] ^= BS_ONES;
+	bs_gf_inv(t, x);
+}
+
+static void bs_xtime(const bs_word_t x[8], bs_word_t y[8])
+{
+	y[0] = x[7];
+	y[1] = x[0] ^ x[7];
+	y[2] = x[1];
+	y[3] = x[2] ^ x[7];
+	y[4] = x[3] ^ x[7];
+	y[5] = x[4];
+	y[6] = x[5];
+	y[7] = x[6];
+}
+
+static void bs_add_round_key(bs_word_t st[128], const uint8_t round_key[AES_BLOCK_SIZE])
+{
+	int p, b;
+
+	for (p = 0; p < 16; p++)
+	{
+		for (b = 0; b < 8; b++)
+		{
+			st[8 * p + b] ^= (bs_word_t)0 - (bs_word_t)((round_key[p] >> b) & 1);
+		}
+	}
+}
+
+/*
+ * MixColumns, same formula as aes_round
+ */
+static void bs_mix_columns(bs_word_t st[128])
+{
+	int c, r, b;
+
+	for (c = 0; c < 4; c++)
+	{
+		bs_word_t *col[4], sum[8], d[8], x[4][8];
+
+		for (r = 0; r < 4; r++)
+		{
+			col[r] = st + 8 * (4 * c + r);
+		}
+		for (b = 0; b < 8; b++)
+		{
+			sum[b] = col[0][b] ^ col[1][b] ^ col[2][b] ^ col[3][b];
+		}
+		for (r = 0; r < 4; r++)
+		{
+			for (b = 0; b < 8; b++)
+			{
+				d[b] = col[r][b] ^ col[(r + 1) & 3][b];
+			}
+			bs_xtime(d, x[r]);
+		}
+		for (r = 0; r < 4; r++)
+		{
+			for (b = 0; b < 8; b++)
+			{
+				col[r][b] ^= sum[b] ^ x[r][b];
+			}
+		}
+	}
+}
+
+/*
+ * InvMixColumns = MixColumns * circ(05, 00, 04, 00), as aes_inv_mix_columns
+ */
+static void bs_inv_mix_columns(bs_word_t st[128])
+{
+	int c, r, b;
+
+	for (c = 0; c < 4; c++)
+	{
+		for (r = 0; r < 2; r++)
+		{
+			bs_word_t *a = st + 8 * (4 * c + r);
+			bs_word_t *z = st + 8 * (4 * c + r + 2);
+			bs_word_t d[8], x2[8], x4[8];
+
+			for (b = 0; b < 8; b++)
+			{
+				d[b] = a[b] ^ z[b];
+			}
+			bs_xtime(d, x2);
+			bs_xtime(x2, x4);
+			for (b = 0; b < 8; b++)
+			{
+				a[b] ^= x4[b];
+				z[b] ^= x4[b];
+			}
+		}
+	}
+	bs_mix_columns(st);
+}
+
+static void bs_round(bs_word_t st[128], const uint8_t round_key[AES_BLOCK_SIZE], int lastround)
+{
+	bs_word_t tmp[128];
+	int p, c, r;
+
+	/*
+	 * SubBytes + ShiftRow
+	 * Byte (row r, column c) comes from (row r, column c + r)
+	 */
+	for (p = 0; p < 16; p++)
+	{
+		bs_sbox(st + 8 * p);
+	}
+	for (c = 0; c < 4; c++)
+	{
+		for (r = 0; r < 4; r++)
+		{
+			memcpy(tmp + 8 * (4 * c + r), st + 8 * (4 * ((c + r) & 3) + r), 8 * sizeof(bs_word_t));
+		}
+	}
+
+	if (!lastround)
+	{
+		bs_mix_columns(tmp);
+	}
+
+	memcpy(st, tmp, sizeof(tmp));
+	bs_add_round_key(st, round_key);
+}
+
+/*
+ * Inverse of bs_round: AddRoundKey, InvMixColumns unless @lastround,
+ * InvShiftRow + InvSubBytes
+ */
+static void bs_inv_round(bs_word_t st[128], const uint8_t round_key[AES_BLOCK_SIZE], int lastround)
+{
+	bs_word_t tmp[128];
+	int p, c, r;
+
+	bs_add_round_key(st, round_key);
+	if (!lastround)
+	{
+		bs_inv_mix_columns(st);
+	}
+
+	/*
+	 * Byte (row r, column c + r) goes back to (row r, column c)
+	 */
+	for (c = 0; c < 4; c++)
+	{
+		for (r = 0; r < 4; r++)
+		{
+			memcpy(tmp + 8 * (4 * ((c + r) & 3) + r), st + 8 * (4 * c + r), 8 * sizeof(bs_word_t));
+		}
+	}
+	for (p = 0; p < 16; p++)
+	{
+		bs_inv_sbox(tmp + 8 * p);
+	}
+	memcpy(st, tmp, sizeof(tmp));
+}
+
+static void bs_pack(uint8_t blocks[][AES_BLOCK_SIZE], size_t count, bs_word_t st[128])
+{
+	size_t j;
+	int p, b;
+
+	memset(st, 0, 128 * sizeof(bs_word_t));
+	for (j = 0; j < count; j++)
+	{
+		for (p = 0; p < 16; p++)
+		{
+			for (b = 0; b < 8; b++)
+			{
+				st[8 * p + b] |= (bs_word_t)((blocks[j][p] >> b) & 1) << j;
+			}
+		}
+	}
+}
+
+static void bs_unpack(const bs_word_t st[128], uint8_t blocks[][AES_BLOCK_SIZE], size_t count)
+{
+	size_t j;
+	int p, b;
+
+	for (j = 0; j < count; j++)
+	{
+		for (p = 0; p < 16; p++)
+		{
+			uint8_t v = 0;
+
+			for (b = 0; b < 8; b++)
+			{
+				v |= (uint8_t)(((st[8 * p + b] >> j) & 1) << b);
+			}
+			blocks[j][p] = v;
+		}
+	}
+}
+
+void aes128_bitslice_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                              const aes128_key_schedule_t *ks,
+                              unsigned nrounds, int lastfull)
+{
+	bs_word_t st[128];
+	size_t n, count;
+	unsigned r;
+
+	for (n = 0; n < nblocks; n += count)
+	{
+		count = nblocks - n < AES128_BITSLICE_WIDTH ? nblocks - n : AES128_BITSLICE_WIDTH;
+
+		bs_pack(blocks + n, count, st);
+		bs_add_round_key(st, ks->rk[0]);
+		for (r = 1; r < nrounds; r++)
+		{
+			bs_round(st, ks->rk[r], 0);
+		}
+		bs_round(st, ks->rk[nrounds], !lastfull);
+		bs_unpack(st, blocks + n, count);
+	}
+}
+
+void aes128_bitslice_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                              const aes128_key_schedule_t *ks,
+                              unsigned nrounds, int lastfull)
+{
+	bs_word_t st[128];
+	size_t n, count;
+	unsigned r;
+
+	for (n = 0; n < nblocks; n += count)
+	{
+		count = nblocks - n < AES128_BITSLICE_WIDTH ? nblocks - n : AES128_BITSLICE_WIDTH;
+
+		bs_pack(blocks + n, count, st);
+		bs_inv_round(st, ks->rk[nrounds], !lastfull);
+		for (r = nrounds - 1; r >= 1; r--)
+		{
+			bs_inv_round(st, ks->rk[r], 0);
+		}
+		bs_add_round_key(st, ks->rk[0]);
+		bs_unpack(st, blocks + n, count);
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ * AES-128 Decryption
+ * Byte-Oriented
+ * Precomputed key schedule
+ * Constant-time XTIME
+ */
+
+#include "aes-128_dec.h"
+
+/*
+ * InvMixColumns = MixColumns * circ(05, 00, 04, 00): the extra factor only
+ * takes two more xtime per pair of rows
+ */
+void aes_inv_mix_columns(uint8_t block[AES_BLOCK_SIZE])
+{
+	int i;
+
+	for (i = 0; i < 16; i += 4)
+	{
+		uint8_t *column = block + i;
+		uint8_t u = xtime(xtime(column[0] ^ column[2]));
+		uint8_t v = xtime(xtime(column[1] ^ column[3]));
+
+		column[0] ^= u;
+		column[1] ^= v;
+		column[2] ^= u;
+		column[3] ^= v;
+		aes_mix_column(column);
+	}
+}
+
+void aes_inv_round(uint8_t block[AES_BLOCK_SIZE], const uint8_t round_key[AES_BLOCK_SIZE], int lastround)
+{
+	int i;
+	uint8_t tmp;
+
+	/*
+	 * AddRoundKey
+	 */
+	for (i = 0; i < 16; i++)
+	{
+		block[i] ^= round_key[i];
+	}
+
+	/*
+	 * InvMixColumns
+	 */
+	if (lastround == 0) /* lastround = 16 if it is the last round, 0 otherwise */
+	{
+		aes_inv_mix_columns(block);
+	}
+
+	/*
+	 * InvShiftRow + InvSubBytes
+	 */
+	/* Row 0 */
+	block[ 0] = Sinv[block[ 0]];
+	block[ 4] = Sinv[block[ 4]];
+	block[ 8] = Sinv[block[ 8]];
+	block[12] = Sinv[block[12]];
+	/* Row 1 */
+	tmp = block[13];
+	block[13] = Sinv[block[ 9]];
+	block[ 9] = Sinv[block[ 5]];
+	block[ 5] = Sinv[block[ 1]];
+	block[ 1] = Sinv[tmp];
+	/* Row 2 */
+	tmp = block[2];
+	block[ 2] = Sinv[block[10]];
+	block[10] = Sinv[tmp];
+	tmp = block[6];
+	block[ 6] = Sinv[block[14]];
+	block[14] = Sinv[tmp];
+	/* Row 3 */
+	tmp = block[3];
+	block[ 3] = Sinv[block[ 7]];
+	block[ 7] = Sinv[block[11]];
+	block[11] = Sinv[block[15]];
+	block[15] = Sinv[tmp];
+}
+
+/*
+ * Same as aes128_dec with a precomputed key schedule
+ */
+void aes128_dec_ks(uint8_t block[AES_BLOCK_SIZE], const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull)
+{
+	unsigned i;
+
+	/* Like aes128_enc, at least one round is run */
+	if (nrounds < 1)
+	{
+		nrounds = 1;
+	}
+	aes_inv_round(block, ks->rk[nrounds], lastfull ? 0 : 16);
+	for (i = nrounds - 1; i >= 1; i--)
+	{
+		aes_inv_round(block, ks->rk[i], 0);
+	}
+	for (i = 0; i < 16; i++)
+	{
+		block[i] ^= ks->rk[0][i];
+	}
+}
+
+/*
+ * Decrypt @block with @key (the master key) over @nrounds. If @lastfull is true, the last round includes MixColumn, otherwise it doesn't.
+ * @nrounds <= 10
+ */
+void aes128_dec(uint8_t block[AES_BLOCK_SIZE], const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull)
+{
+	aes128_key_schedule_t ks;
+
+	/* Decryption starts from the last round key: expand first */
+	aes128_expand_key(&ks, key);
+	aes128_dec_ks(block, &ks, nrounds, lastfull);
+}
+
+void aes128_expand_key_from_round(aes128_key_schedule_t *ks, const uint8_t round_key[AES_BLOCK_SIZE], int round)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+	{
+		ks->rk[round][i] = round_key[i];
+	}
+	for (i = round - 1; i >= 0; i--)
+	{
+		prev_aes128_round_key(ks->rk[i + 1], ks->rk[i], i);
+	}
+	for (i = round; i < AES128_MAX_ROUNDS; i++)
+	{
+		next_aes128_round_key(ks->rk[i], ks->rk[i + 1], i);
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef __AES_128_DEC__H__
+#define __AES_128_DEC__H__
+
+#include "aes-128_enc.h"
+
+/*
+ * AES-128 inverse cipher
+ * Same @nrounds / @lastfull contract and key schedule as encryption:
+ * aes128_dec(aes128_enc(x, k, n, l), k, n, l) = x
+ */
+
+/*
+ * Decrypt @block with @key (the master key) over @nrounds. If @lastfull is true, the last round includes MixColumn, otherwise it doesn't.
+ * @nrounds <= 10
+ */
+void aes128_dec(uint8_t block[AES_BLOCK_SIZE], const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull);
+
+/*
+ * Same as aes128_dec with a precomputed key schedule
+ */
+void aes128_dec_ks(uint8_t block[AES_BLOCK_SIZE], const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull);
+
+/*
+ * Inverse of aes_round: AddRoundKey with @round_key, InvMixColumns unless
+ * @lastround is 16 (0 otherwise), InvShiftRow + InvSubBytes
+ */
+void aes_inv_round(uint8_t block[AES_BLOCK_SIZE], const uint8_t round_key[AES_BLOCK_SIZE], int lastround);
+
+/*
+ * InvMixColumns on the four columns of @block
+ */
+void aes_inv_mix_columns(uint8_t block[AES_BLOCK_SIZE]);
+
+/*
+ * Rebuild the full key schedule from the @round-th round key alone, as
+ * recovered by an attack on the last round
+ * @round in {0...10}
+ */
+void aes128_expand_key_from_round(aes128_key_schedule_t *ks, const uint8_t round_key[AES_BLOCK_SIZE], int round);
+
+#endif // __AES_128_DEC__H__
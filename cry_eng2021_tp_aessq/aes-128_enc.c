@@ -21,12 +21,23 @@ uint8_t xtime(uint8_t p)
 	return ((p << 1) ^ m);
 }
 
+void aes_mix_column(uint8_t column[4])
+{
+	uint8_t tmp = column[0] ^ column[1] ^ column[2] ^ column[3];
+	uint8_t tmp2 = column[0];
+
+	column[0] ^= tmp ^ xtime(column[0] ^ column[1]);
+	column[1] ^= tmp ^ xtime(column[1] ^ column[2]);
+	column[2] ^= tmp ^ xtime(column[2] ^ column[3]);
+	column[3] ^= tmp ^ xtime(column[3] ^ tmp2);
+}
+
 /*
  * The round constants
  */
 static const uint8_t RC[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
 
-void aes_round(uint8_t block[AES_BLOCK_SIZE], uint8_t round_key[AES_BLOCK_SIZE], int lastround)
+void aes_round(uint8_t block[AES_BLOCK_SIZE], const uint8_t round_key[AES_BLOCK_SIZE], int lastround)
 {
 	int i;
 	uint8_t tmp;
@@ -64,14 +75,7 @@ void aes_round(uint8_t block[AES_BLOCK_SIZE], uint8_t round_key[AES_BLOCK_SIZE],
 	 */
 	for (i = lastround; i < 16; i += 4) /* lastround = 16 if it is the last round, 0 otherwise */
 	{
-		uint8_t *column = block + i;
-		uint8_t tmp2 = column[0];
-		tmp = column[0] ^ column[1] ^ column[2] ^ column[3];
-
-		column[0] ^= tmp ^ xtime(column[0] ^ column[1]);
-		column[1] ^= tmp ^ xtime(column[1] ^ column[2]);
-		column[2] ^= tmp ^ xtime(column[2] ^ column[3]);
-		column[3] ^= tmp ^ xtime(column[3] ^ tmp2);
+		aes_mix_column(block + i);
 	}
 
 	/*
@@ -141,7 +145,7 @@ void aes128_enc(uint8_t block[AES_BLOCK_SIZE], const uint8_t key[AES_128_KEY_SIZ
 
 	pk = 0;
 	nk = 16;
-	for (i = 1; i < nrounds; i++)
+	for (i = 1; i < (int)nrounds; i++)
 	{
 		aes_round(block, ekey + nk, 0);
 		pk = (pk + 16) & 0x10;
@@ -158,10 +162,62 @@ void aes128_enc(uint8_t block[AES_BLOCK_SIZE], const uint8_t key[AES_128_KEY_SIZ
 	}
 }
 
+/*
+ * Expand @key into the full set of round keys
+ */
+void aes128_expand_key(aes128_key_schedule_t *ks, const uint8_t key[AES_128_KEY_SIZE])
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+	{
+		ks->rk[0][i] = key[i];
+	}
+	for (i = 0; i < AES128_MAX_ROUNDS; i++)
+	{
+		next_aes128_round_key(ks->rk[i], ks->rk[i + 1], i);
+	}
+}
+
+/*
+ * Same as aes128_enc with a precomputed key schedule: only round work per block
+ */
+void aes128_enc_ks(uint8_t block[AES_BLOCK_SIZE], const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull)
+{
+	unsigned i;
+
+	for (i = 0; i < 16; i++)
+	{
+		block[i] ^= ks->rk[0][i];
+	}
+	for (i = 1; i < nrounds; i++)
+	{
+		aes_round(block, ks->rk[i], 0);
+	}
+	/* Like aes128_enc, at least one round is run */
+	if (i < 1)
+	{
+		i = 1;
+	}
+	aes_round(block, ks->rk[i], lastfull ? 0 : 16);
+}
+
 /*
  * F construction: F(k1||k2, x) = E(k1, x) ⊕ E(k2, x) using 3-round AES
  */
 void F_construction(const uint8_t k1[16], const uint8_t k2[16], const uint8_t x[16], uint8_t result[16])
+{
+	aes128_key_schedule_t ks1, ks2;
+
+	aes128_expand_key(&ks1, k1);
+	aes128_expand_key(&ks2, k2);
+	F_construction_ks(&ks1, &ks2, x, result);
+}
+
+/*
+ * F construction with both key schedules precomputed
+ */
+void F_construction_ks(const aes128_key_schedule_t *ks1, const aes128_key_schedule_t *ks2, const uint8_t x[16], uint8_t result[16])
 {
 	uint8_t e1[16], e2[16];
 	int i;
@@ -172,10 +228,10 @@ void F_construction(const uint8_t k1[16], const uint8_t k2[16], const uint8_t x[
 	}
 	
 	// Compute E(k1, x) with 3 rounds
-	aes128_enc(e1, k1, 3, 0);
+	aes128_enc_ks(e1, ks1, 3, 0);
 	
 	// Compute E(k2, x) with 3 rounds
-	aes128_enc(e2, k2, 3, 0);
+	aes128_enc_ks(e2, ks2, 3, 0);
 	
 	// XOR results: F(k1||k2, x) = E(k1, x) ⊕ E(k2, x)
 	for (i = 0; i < 16; i++) {
@@ -5,12 +5,55 @@
 #ifndef __AES_128_ENC__H__
 #define __AES_128_ENC__H__
 
+#define AES128_MAX_ROUNDS 10
+
+/*
+ * Expanded key: round keys 0...10, computed once by aes128_expand_key and
+ * usable for any round count
+ */
+typedef struct {
+	uint8_t rk[AES128_MAX_ROUNDS + 1][AES_BLOCK_SIZE];
+} aes128_key_schedule_t;
+
 /*
  * Encrypt @block with @key over @nrounds. If @lastfull is true, the last round includes MixColumn, otherwise it doesn't.
  * @nrounds <= 10
  */
 void aes128_enc(uint8_t block[AES_BLOCK_SIZE], const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull);
 
+/*
+ * Expand @key into the full set of round keys
+ */
+void aes128_expand_key(aes128_key_schedule_t *ks, const uint8_t key[AES_128_KEY_SIZE]);
+
+/*
+ * Same as aes128_enc with a precomputed key schedule: only round work per block
+ */
+void aes128_enc_ks(uint8_t block[AES_BLOCK_SIZE], const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull);
+
+/*
+ * One AES round on @block with @round_key: SubBytes, ShiftRow, MixColumns unless
+ * @lastround is 16 (0 otherwise), AddRoundKey
+ */
+void aes_round(uint8_t block[AES_BLOCK_SIZE], const uint8_t round_key[AES_BLOCK_SIZE], int lastround);
+
+/*
+ * Constant-time multiplication by $a$ in $F_2[X]/X^8 + X^4 + X^3 + X + 1$
+ */
+uint8_t xtime(uint8_t p);
+
+/*
+ * MixColumns on one column of four bytes, as in aes_round
+ */
+void aes_mix_column(uint8_t column[4]);
+
+/*
+ * Compute the @(round + 1)-th round key in @next_key, given the @round-th key in @prev_key
+ * @round in {0...9}
+ * The ``master key'' is the 0-th round key
+ */
+void next_aes128_round_key(const uint8_t prev_key[16], uint8_t next_key[16], int round);
+
 /*
  * The AES S-box, duh
  */
@@ -69,4 +112,9 @@ void prev_aes128_round_key(const uint8_t next_key[16], uint8_t prev_key[16], int
  */
 void F_construction(const uint8_t k1[16], const uint8_t k2[16], const uint8_t x[16], uint8_t result[16]);
 
+/*
+ * F construction with both key schedules precomputed
+ */
+void F_construction_ks(const aes128_key_schedule_t *ks1, const aes128_key_schedule_t *ks2, const uint8_t x[16], uint8_t result[16]);
+
 #endif // __AES-128_ENC__H__
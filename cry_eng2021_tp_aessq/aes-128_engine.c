@@ -0,0 +1,287 @@
+/*
+ * AES-128 Encryption and Decryption
+ * Multi-block engine: blocks dispatched to the selected backend
+ * with a precomputed key schedule
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aes-128_engine.h"
+#include "aes-128_backend.h"
+#include "aes-128_dec.h"
+
+static void reference_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                               const aes128_key_schedule_t *ks,
+                               unsigned nrounds, int lastfull)
+{
+	size_t n;
+
+	for (n = 0; n < nblocks; n++)
+	{
+		aes128_enc_ks(blocks[n], ks, nrounds, lastfull);
+	}
+}
+
+static void reference_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                               const aes128_key_schedule_t *ks,
+                               unsigned nrounds, int lastfull)
+{
+	size_t n;
+
+	for (n = 0; n < nblocks; n++)
+	{
+		aes128_dec_ks(blocks[n], ks, nrounds, lastfull);
+	}
+}
+
+/*
+ * Backends without their own F kernel get this
+ */
+static void generic_f_many(aes128_enc_many_fn enc_many,
+                           const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                           size_t nblocks, const aes128_key_schedule_t *ks1,
+                           const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	uint8_t e1[AES128_F_CHUNK][AES_BLOCK_SIZE];
+	uint8_t e2[AES128_F_CHUNK][AES_BLOCK_SIZE];
+	size_t n, count, i;
+	int j;
+
+	for (n = 0; n < nblocks; n += count)
+	{
+		count = nblocks - n < AES128_F_CHUNK ? nblocks - n : AES128_F_CHUNK;
+		memcpy(e1, in[n], count * AES_BLOCK_SIZE);
+		memcpy(e2, in[n], count * AES_BLOCK_SIZE);
+		enc_many(e1, count, ks1, nrounds, lastfull);
+		enc_many(e2, count, ks2, nrounds, lastfull);
+		for (i = 0; i < count; i++)
+		{
+			for (j = 0; j < AES_BLOCK_SIZE; j++)
+			{
+				out[n + i][j] = e1[i][j] ^ e2[i][j];
+			}
+		}
+	}
+}
+
+static void reference_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                             size_t nblocks, const aes128_key_schedule_t *ks1,
+                             const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	generic_f_many(reference_enc_many, in, out, nblocks, ks1, ks2, nrounds, lastfull);
+}
+
+static void bitslice_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                            size_t nblocks, const aes128_key_schedule_t *ks1,
+                            const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	generic_f_many(aes128_bitslice_enc_many, in, out, nblocks, ks1, ks2, nrounds, lastfull);
+}
+
+static const struct {
+	const char *name;
+	aes128_enc_many_fn enc_many;
+	aes128_dec_many_fn dec_many;
+	aes128_f_many_fn f_many;
+} backends[AES128_BACKEND_COUNT] = {
+	[AES128_BACKEND_AUTO]      = {"auto",      NULL,                     NULL,                     NULL},
+	[AES128_BACKEND_REFERENCE] = {"reference", reference_enc_many,       reference_dec_many,       reference_f_many},
+	[AES128_BACKEND_TTABLE]    = {"ttable",    aes128_ttable_enc_many,   aes128_ttable_dec_many,   aes128_ttable_f_many},
+	[AES128_BACKEND_BITSLICE]  = {"bitslice",  aes128_bitslice_enc_many, aes128_bitslice_dec_many, bitslice_f_many},
+	[AES128_BACKEND_AESNI]     = {"aesni",     aes128_aesni_enc_many,    aes128_aesni_dec_many,    aes128_aesni_f_many},
+};
+
+static aes128_backend_t current_backend;
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+
+static int has_aesni;
+
+/*
+ * AUTO prefers AES-NI, then the portable T-tables
+ */
+static aes128_backend_t resolve_backend(aes128_backend_t backend)
+{
+	if (backend == AES128_BACKEND_AUTO)
+	{
+		return has_aesni ? AES128_BACKEND_AESNI : AES128_BACKEND_TTABLE;
+	}
+	return backend;
+}
+
+static void engine_init(void)
+{
+	const char *env = getenv("AES128_BACKEND");
+	aes128_backend_t backend = AES128_DEFAULT_BACKEND;
+
+	has_aesni = aes128_aesni_available();
+	if (!aes128_backend_available(backend))
+	{
+		backend = AES128_BACKEND_AUTO;
+	}
+	if (env)
+	{
+		aes128_backend_t requested = aes128_backend_from_name(env);
+
+		if (aes128_backend_available(requested))
+		{
+			backend = requested;
+		}
+	}
+	current_backend = resolve_backend(backend);
+}
+
+int aes128_backend_available(aes128_backend_t backend)
+{
+	if (backend == AES128_BACKEND_AESNI)
+	{
+		return aes128_aesni_available();
+	}
+	return backend >= AES128_BACKEND_AUTO && backend < AES128_BACKEND_COUNT;
+}
+
+const char *aes128_backend_name(aes128_backend_t backend)
+{
+	if (backend < AES128_BACKEND_AUTO || backend >= AES128_BACKEND_COUNT)
+	{
+		return "unknown";
+	}
+	return backends[backend].name;
+}
+
+aes128_backend_t aes128_backend_from_name(const char *name)
+{
+	int i;
+
+	for (i = 0; name && i < AES128_BACKEND_COUNT; i++)
+	{
+		if (strcmp(name, backends[i].name) == 0)
+		{
+			return (aes128_backend_t)i;
+		}
+	}
+	return AES128_BACKEND_COUNT;
+}
+
+int aes128_engine_set_backend(aes128_backend_t backend)
+{
+	pthread_once(&engine_once, engine_init);
+	if (!aes128_backend_available(backend))
+	{
+		return -1;
+	}
+	current_backend = resolve_backend(backend);
+	return 0;
+}
+
+aes128_backend_t aes128_engine_backend(void)
+{
+	pthread_once(&engine_once, engine_init);
+	return current_backend;
+}
+
+void aes128_enc_many_ks(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                        const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull)
+{
+	pthread_once(&engine_once, engine_init);
+
+	/* aes128_enc always runs at least one round */
+	if (nrounds == 0)
+	{
+		nrounds = 1;
+	}
+	backends[current_backend].enc_many(blocks, nblocks, ks, nrounds, lastfull);
+}
+
+void aes128_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                     const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull)
+{
+	aes128_key_schedule_t ks;
+
+	aes128_expand_key(&ks, key);
+	aes128_enc_many_ks(blocks, nblocks, &ks, nrounds, lastfull);
+}
+
+void aes128_dec_many_ks(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                        const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull)
+{
+	pthread_once(&engine_once, engine_init);
+
+	if (nrounds == 0)
+	{
+		nrounds = 1;
+	}
+	backends[current_backend].dec_many(blocks, nblocks, ks, nrounds, lastfull);
+}
+
+void aes128_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                     const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull)
+{
+	aes128_key_schedule_t ks;
+
+	aes128_expand_key(&ks, key);
+	aes128_dec_many_ks(blocks, nblocks, &ks, nrounds, lastfull);
+}
+
+void aes128_f_init(aes128_f_key_t *fk, const uint8_t k1[AES_128_KEY_SIZE],
+                   const uint8_t k2[AES_128_KEY_SIZE])
+{
+	aes128_expand_key(&fk->ks1, k1);
+	aes128_expand_key(&fk->ks2, k2);
+}
+
+void aes128_f_many(const aes128_f_key_t *fk, const uint8_t in[][AES_BLOCK_SIZE],
+                   uint8_t out[][AES_BLOCK_SIZE], size_t nblocks)
+{
+	pthread_once(&engine_once, engine_init);
+	backends[current_backend].f_many(in, out, nblocks, &fk->ks1, &fk->ks2,
+	                                 AES128_F_ROUNDS, 0);
+}
+
+void aes128_f_stream_init(aes128_f_stream_t *stream, const uint8_t k1[AES_128_KEY_SIZE],
+                          const uint8_t k2[AES_128_KEY_SIZE])
+{
+	aes128_f_init(&stream->key, k1, k2);
+	stream->pending = 0;
+}
+
+size_t aes128_f_stream_update(aes128_f_stream_t *stream, const uint8_t *in, size_t length,
+                              uint8_t *out)
+{
+	size_t written = 0;
+	size_t whole;
+
+	/* Complete the buffered block first */
+	if (stream->pending > 0)
+	{
+		size_t take = AES_BLOCK_SIZE - stream->pending;
+
+		if (take > length)
+		{
+			take = length;
+		}
+		memcpy(stream->buffer + stream->pending, in, take);
+		stream->pending += take;
+		in += take;
+		length -= take;
+		if (stream->pending < AES_BLOCK_SIZE)
+		{
+			return 0;
+		}
+		aes128_f_many(&stream->key, (const uint8_t (*)[AES_BLOCK_SIZE])stream->buffer,
+		              (uint8_t (*)[AES_BLOCK_SIZE])out, 1);
+		stream->pending = 0;
+		written = AES_BLOCK_SIZE;
+	}
+
+	/* Whole blocks straight from @in to @out */
+	whole = length / AES_BLOCK_SIZE;
+	aes128_f_many(&stream->key, (const uint8_t (*)[AES_BLOCK_SIZE])in,
+	              (uint8_t (*)[AES_BLOCK_SIZE])(out + written), whole);
+	written += whole * AES_BLOCK_SIZE;
+
+	stream->pending = length - whole * AES_BLOCK_SIZE;
+	memcpy(stream->buffer, in + whole * AES_BLOCK_SIZE, stream->pending);
+	return written;
+}
@@ -0,0 +1,139 @@
+#ifndef __AES_128_ENGINE__H__
+#define __AES_128_ENGINE__H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes-128_enc.h"
+
+/*
+ * Multi-block AES-128 encryption engine
+ * =====================================
+ * Same @nrounds / @lastfull contract as aes128_enc, but the blocks are handed
+ * to a pluggable backend together with a precomputed key schedule.
+ * Every backend is bit-identical to aes128_enc, and to aes128_dec for
+ * decryption.
+ */
+
+typedef enum {
+	AES128_BACKEND_AUTO = 0,   /* Fastest backend available on this machine */
+	AES128_BACKEND_REFERENCE,  /* Byte-oriented aes128_enc, one block at a time */
+	AES128_BACKEND_TTABLE,     /* 32-bit T-tables */
+	AES128_BACKEND_BITSLICE,   /* Constant-time, AES128_BITSLICE_WIDTH blocks at once */
+	AES128_BACKEND_AESNI,      /* AESENC/AESENCLAST, x86 with AES-NI only (cpuid) */
+	AES128_BACKEND_COUNT
+} aes128_backend_t;
+
+/*
+ * Compile-time default, overridden at runtime by the AES128_BACKEND
+ * environment variable or aes128_engine_set_backend()
+ */
+#ifndef AES128_DEFAULT_BACKEND
+#define AES128_DEFAULT_BACKEND AES128_BACKEND_AUTO
+#endif
+
+/*
+ * Encrypt the @nblocks blocks of @blocks in place with the expanded key @ks
+ * over @nrounds. If @lastfull is true, the last round includes MixColumn,
+ * otherwise it doesn't.
+ * @nrounds <= 10
+ */
+void aes128_enc_many_ks(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                        const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull);
+
+/*
+ * Same as aes128_enc_many_ks, expanding @key first.
+ * Encrypt the @nblocks blocks of @blocks in place with @key over @nrounds.
+ * If @lastfull is true, the last round includes MixColumn, otherwise it doesn't.
+ * @nrounds <= 10
+ */
+void aes128_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                     const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull);
+
+/*
+ * Inverse of aes128_enc_many_ks: decrypt the @nblocks blocks of @blocks in
+ * place with the same expanded key @ks, @nrounds and @lastfull.
+ * @nrounds <= 10
+ */
+void aes128_dec_many_ks(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                        const aes128_key_schedule_t *ks, unsigned nrounds, int lastfull);
+
+/*
+ * Same as aes128_dec_many_ks, expanding @key (the master key) first.
+ */
+void aes128_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                     const uint8_t key[AES_128_KEY_SIZE], unsigned nrounds, int lastfull);
+
+/*
+ * Select the backend used by aes128_enc_many and aes128_dec_many.
+ * Returns 0 on success, -1 if @backend is not available on this machine.
+ * Not safe to call while other threads are encrypting.
+ */
+int aes128_engine_set_backend(aes128_backend_t backend);
+
+/*
+ * The backend currently in use (never AES128_BACKEND_AUTO)
+ */
+aes128_backend_t aes128_engine_backend(void);
+
+/*
+ * Returns true if @backend can run on this machine
+ */
+int aes128_backend_available(aes128_backend_t backend);
+
+/*
+ * Name <-> identifier mapping ("auto", "reference", "ttable", "bitslice", "aesni").
+ * aes128_backend_from_name returns AES128_BACKEND_COUNT for unknown names.
+ */
+const char *aes128_backend_name(aes128_backend_t backend);
+aes128_backend_t aes128_backend_from_name(const char *name);
+
+/*
+ * Batched F construction
+ * ======================
+ * F(k1||k2, x) = E(k1, x) ⊕ E(k2, x) over AES128_F_ROUNDS rounds, the same
+ * function as F_construction, with both key schedules expanded once and
+ * the two encryptions interleaved by the selected backend.
+ */
+
+#define AES128_F_ROUNDS 3
+/* Blocks per step of backends without an interleaved F kernel */
+#define AES128_F_CHUNK 64
+
+typedef struct {
+	aes128_key_schedule_t ks1;
+	aes128_key_schedule_t ks2;
+} aes128_f_key_t;
+
+void aes128_f_init(aes128_f_key_t *fk, const uint8_t k1[AES_128_KEY_SIZE],
+                   const uint8_t k2[AES_128_KEY_SIZE]);
+
+/*
+ * out[i] = F(k1||k2, in[i]) for @nblocks inputs. @out may be @in.
+ */
+void aes128_f_many(const aes128_f_key_t *fk, const uint8_t in[][AES_BLOCK_SIZE],
+                   uint8_t out[][AES_BLOCK_SIZE], size_t nblocks);
+
+/*
+ * Streaming: the input is a byte stream cut into 16-byte blocks x, any
+ * split across calls
+ */
+typedef struct {
+	aes128_f_key_t key;
+	uint8_t buffer[AES_BLOCK_SIZE];   /* start of an incomplete block */
+	size_t pending;                   /* bytes in @buffer */
+} aes128_f_stream_t;
+
+void aes128_f_stream_init(aes128_f_stream_t *stream, const uint8_t k1[AES_128_KEY_SIZE],
+                          const uint8_t k2[AES_128_KEY_SIZE]);
+
+/*
+ * Consume @length bytes of @in, write F of every block completed to @out
+ * and return the number of bytes written, a multiple of 16. @out needs
+ * room for @length + 15 bytes; it may be @in only if nothing is pending.
+ * The last incomplete block stays in @stream->buffer.
+ */
+size_t aes128_f_stream_update(aes128_f_stream_t *stream, const uint8_t *in, size_t length,
+                              uint8_t *out);
+
+#endif // __AES_128_ENGINE__H__
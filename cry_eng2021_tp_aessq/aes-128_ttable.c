@@ -0,0 +1,308 @@
+/*
+ * AES-128 Encryption and Decryption
+ * 32-bit T-table backend
+ * Tables generated once from S, Sinv and xtime
+ *
+ * Columns are held as little-endian words: row 0 is the low byte.
+ * NOT constant-time: table indices depend on the state.
+ */
+
+#include <pthread.h>
+
+#include "aes-128_backend.h"
+
+static uint32_t Te[4][256];
+static pthread_once_t te_once = PTHREAD_ONCE_INIT;
+static uint32_t Td[4][256];
+static pthread_once_t td_once = PTHREAD_ONCE_INIT;
+
+static uint32_t rotl32(uint32_t x, unsigned n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+/*
+ * Te[r][x] is the contribution of S[x] sitting in row @r to its MixColumns output column
+ */
+static void te_init(void)
+{
+	int x, r;
+
+	for (x = 0; x < 256; x++)
+	{
+		uint8_t s  = S[x];
+		uint8_t s2 = xtime(s);
+		uint8_t s3 = s2 ^ s;
+
+		Te[0][x] = (uint32_t)s2 | ((uint32_t)s << 8) | ((uint32_t)s << 16) | ((uint32_t)s3 << 24);
+		for (r = 1; r < 4; r++)
+		{
+			Te[r][x] = rotl32(Te[0][x], 8 * r);
+		}
+	}
+}
+
+/*
+ * Td[r][x] is the contribution of Sinv[x] sitting in row @r to its
+ * InvMixColumns output column, InvMixColumns row (0e 0b 0d 09)
+ */
+static void td_init(void)
+{
+	int x, r;
+
+	for (x = 0; x < 256; x++)
+	{
+		uint8_t v  = Sinv[x];
+		uint8_t v2 = xtime(v);
+		uint8_t v4 = xtime(v2);
+		uint8_t v8 = xtime(v4);
+
+		Td[0][x] = (uint32_t)(v8 ^ v4 ^ v2) | ((uint32_t)(v8 ^ v) << 8) |
+		           ((uint32_t)(v8 ^ v4 ^ v) << 16) | ((uint32_t)(v8 ^ v2 ^ v) << 24);
+		for (r = 1; r < 4; r++)
+		{
+			Td[r][x] = rotl32(Td[0][x], 8 * r);
+		}
+	}
+}
+
+static uint32_t load32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store32(uint8_t *p, uint32_t w)
+{
+	p[0] = (uint8_t)w;
+	p[1] = (uint8_t)(w >> 8);
+	p[2] = (uint8_t)(w >> 16);
+	p[3] = (uint8_t)(w >> 24);
+}
+
+/*
+ * One round on the state columns s0...s3 with round key words @k, through
+ * the temporaries t0...t3
+ * Output column c takes row r from input column c + r
+ */
+#define TE_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, k) \
+	do { \
+		t0 = Te[0][s0 & 0xff] ^ Te[1][(s1 >> 8) & 0xff] ^ Te[2][(s2 >> 16) & 0xff] ^ Te[3][s3 >> 24] ^ (k)[0]; \
+		t1 = Te[0][s1 & 0xff] ^ Te[1][(s2 >> 8) & 0xff] ^ Te[2][(s3 >> 16) & 0xff] ^ Te[3][s0 >> 24] ^ (k)[1]; \
+		t2 = Te[0][s2 & 0xff] ^ Te[1][(s3 >> 8) & 0xff] ^ Te[2][(s0 >> 16) & 0xff] ^ Te[3][s1 >> 24] ^ (k)[2]; \
+		t3 = Te[0][s3 & 0xff] ^ Te[1][(s0 >> 8) & 0xff] ^ Te[2][(s1 >> 16) & 0xff] ^ Te[3][s2 >> 24] ^ (k)[3]; \
+		s0 = t0; s1 = t1; s2 = t2; s3 = t3; \
+	} while (0)
+
+#define SUB_SHIFT(a, b, c, d) \
+	((uint32_t)S[(a) & 0xff] | ((uint32_t)S[((b) >> 8) & 0xff] << 8) | ((uint32_t)S[((c) >> 16) & 0xff] << 16) | ((uint32_t)S[(d) >> 24] << 24))
+
+/*
+ * Same, last round without MixColumns
+ */
+#define LAST_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, k) \
+	do { \
+		t0 = SUB_SHIFT(s0, s1, s2, s3) ^ (k)[0]; \
+		t1 = SUB_SHIFT(s1, s2, s3, s0) ^ (k)[1]; \
+		t2 = SUB_SHIFT(s2, s3, s0, s1) ^ (k)[2]; \
+		t3 = SUB_SHIFT(s3, s0, s1, s2) ^ (k)[3]; \
+		s0 = t0; s1 = t1; s2 = t2; s3 = t3; \
+	} while (0)
+
+/*
+ * Inverse round of the equivalent inverse cipher: InvSubBytes + InvShiftRow
+ * + InvMixColumns, then the InvMixColumns-transformed round key @k
+ * Output column c takes row r from input column c - r
+ */
+#define TD_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, k) \
+	do { \
+		t0 = Td[0][s0 & 0xff] ^ Td[1][(s3 >> 8) & 0xff] ^ Td[2][(s2 >> 16) & 0xff] ^ Td[3][s1 >> 24] ^ (k)[0]; \
+		t1 = Td[0][s1 & 0xff] ^ Td[1][(s0 >> 8) & 0xff] ^ Td[2][(s3 >> 16) & 0xff] ^ Td[3][s2 >> 24] ^ (k)[1]; \
+		t2 = Td[0][s2 & 0xff] ^ Td[1][(s1 >> 8) & 0xff] ^ Td[2][(s0 >> 16) & 0xff] ^ Td[3][s3 >> 24] ^ (k)[2]; \
+		t3 = Td[0][s3 & 0xff] ^ Td[1][(s2 >> 8) & 0xff] ^ Td[2][(s1 >> 16) & 0xff] ^ Td[3][s0 >> 24] ^ (k)[3]; \
+		s0 = t0; s1 = t1; s2 = t2; s3 = t3; \
+	} while (0)
+
+#define INV_SUB_SHIFT(a, b, c, d) \
+	((uint32_t)Sinv[(a) & 0xff] | ((uint32_t)Sinv[((b) >> 8) & 0xff] << 8) | ((uint32_t)Sinv[((c) >> 16) & 0xff] << 16) | ((uint32_t)Sinv[(d) >> 24] << 24))
+
+/*
+ * Same, without InvMixColumns
+ */
+#define INV_LAST_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, k) \
+	do { \
+		t0 = INV_SUB_SHIFT(s0, s3, s2, s1) ^ (k)[0]; \
+		t1 = INV_SUB_SHIFT(s1, s0, s3, s2) ^ (k)[1]; \
+		t2 = INV_SUB_SHIFT(s2, s1, s0, s3) ^ (k)[2]; \
+		t3 = INV_SUB_SHIFT(s3, s2, s1, s0) ^ (k)[3]; \
+		s0 = t0; s1 = t1; s2 = t2; s3 = t3; \
+	} while (0)
+
+/*
+ * InvMixColumns of one column: Td already holds Sinv, undo it with S
+ */
+static uint32_t inv_mix_word(uint32_t w)
+{
+	return Td[0][S[w & 0xff]] ^ Td[1][S[(w >> 8) & 0xff]] ^ Td[2][S[(w >> 16) & 0xff]] ^ Td[3][S[w >> 24]];
+}
+
+static void load_key_words(uint32_t w[AES128_MAX_ROUNDS + 1][4],
+                           const aes128_key_schedule_t *ks, unsigned nrounds)
+{
+	unsigned r;
+	int c;
+
+	for (r = 0; r <= nrounds; r++)
+	{
+		for (c = 0; c < 4; c++)
+		{
+			w[r][c] = load32(ks->rk[r] + 4 * c);
+		}
+	}
+}
+
+void aes128_ttable_enc_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                            const aes128_key_schedule_t *ks,
+                            unsigned nrounds, int lastfull)
+{
+	uint32_t w[AES128_MAX_ROUNDS + 1][4];
+	unsigned mid = lastfull ? nrounds : nrounds - 1;
+	unsigned r;
+	size_t n;
+
+	pthread_once(&te_once, te_init);
+	load_key_words(w, ks, nrounds);
+
+	for (n = 0; n < nblocks; n++)
+	{
+		uint8_t *block = blocks[n];
+		uint32_t s0 = load32(block     ) ^ w[0][0];
+		uint32_t s1 = load32(block +  4) ^ w[0][1];
+		uint32_t s2 = load32(block +  8) ^ w[0][2];
+		uint32_t s3 = load32(block + 12) ^ w[0][3];
+		uint32_t t0, t1, t2, t3;
+
+		/*
+		 * SubBytes + ShiftRow + MixColumns + AddRoundKey
+		 */
+		for (r = 1; r <= mid; r++)
+		{
+			TE_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[r]);
+		}
+
+		/*
+		 * Last round without MixColumns
+		 */
+		if (!lastfull)
+		{
+			LAST_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[nrounds]);
+		}
+
+		store32(block     , s0);
+		store32(block +  4, s1);
+		store32(block +  8, s2);
+		store32(block + 12, s3);
+	}
+}
+
+/*
+ * Equivalent inverse cipher: InvMixColumns is moved past AddRoundKey, so
+ * the middle round keys are transformed once and every inverse round is a
+ * single Td lookup per byte
+ */
+void aes128_ttable_dec_many(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                            const aes128_key_schedule_t *ks,
+                            unsigned nrounds, int lastfull)
+{
+	uint32_t w[AES128_MAX_ROUNDS + 1][4];
+	unsigned r;
+	size_t n;
+	int c;
+
+	pthread_once(&td_once, td_init);
+	load_key_words(w, ks, nrounds);
+	for (r = 1; r < nrounds; r++)
+	{
+		for (c = 0; c < 4; c++)
+		{
+			w[r][c] = inv_mix_word(w[r][c]);
+		}
+	}
+
+	for (n = 0; n < nblocks; n++)
+	{
+		uint8_t *block = blocks[n];
+		uint32_t s0 = load32(block     ) ^ w[nrounds][0];
+		uint32_t s1 = load32(block +  4) ^ w[nrounds][1];
+		uint32_t s2 = load32(block +  8) ^ w[nrounds][2];
+		uint32_t s3 = load32(block + 12) ^ w[nrounds][3];
+		uint32_t t0, t1, t2, t3;
+
+		/*
+		 * Last round with MixColumns
+		 */
+		if (lastfull)
+		{
+			s0 = inv_mix_word(s0);
+			s1 = inv_mix_word(s1);
+			s2 = inv_mix_word(s2);
+			s3 = inv_mix_word(s3);
+		}
+
+		for (r = nrounds - 1; r >= 1; r--)
+		{
+			TD_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[r]);
+		}
+		INV_LAST_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[0]);
+
+		store32(block     , s0);
+		store32(block +  4, s1);
+		store32(block +  8, s2);
+		store32(block + 12, s3);
+	}
+}
+
+/*
+ * F: both encryptions of a block in the same loop. The two dependency
+ * chains are independent, so their table loads overlap.
+ */
+void aes128_ttable_f_many(const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+                          size_t nblocks, const aes128_key_schedule_t *ks1,
+                          const aes128_key_schedule_t *ks2, unsigned nrounds, int lastfull)
+{
+	uint32_t w[AES128_MAX_ROUNDS + 1][4];
+	uint32_t v[AES128_MAX_ROUNDS + 1][4];
+	unsigned mid = lastfull ? nrounds : nrounds - 1;
+	unsigned r;
+	size_t n;
+
+	pthread_once(&te_once, te_init);
+	load_key_words(w, ks1, nrounds);
+	load_key_words(v, ks2, nrounds);
+
+	for (n = 0; n < nblocks; n++)
+	{
+		uint32_t x0 = load32(in[n]     );
+		uint32_t x1 = load32(in[n] +  4);
+		uint32_t x2 = load32(in[n] +  8);
+		uint32_t x3 = load32(in[n] + 12);
+		uint32_t s0 = x0 ^ w[0][0], s1 = x1 ^ w[0][1], s2 = x2 ^ w[0][2], s3 = x3 ^ w[0][3];
+		uint32_t u0 = x0 ^ v[0][0], u1 = x1 ^ v[0][1], u2 = x2 ^ v[0][2], u3 = x3 ^ v[0][3];
+		uint32_t t0, t1, t2, t3;
+
+		for (r = 1; r <= mid; r++)
+		{
+			TE_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[r]);
+			TE_ROUND(u0, u1, u2, u3, t0, t1, t2, t3, v[r]);
+		}
+		if (!lastfull)
+		{
+			LAST_ROUND(s0, s1, s2, s3, t0, t1, t2, t3, w[nrounds]);
+			LAST_ROUND(u0, u1, u2, u3, t0, t1, t2, t3, v[nrounds]);
+		}
+
+		store32(out[n]     , s0 ^ u0);
+		store32(out[n] +  4, s1 ^ u1);
+		store32(out[n] +  8, s2 ^ u2);
+		store32(out[n] + 12, s3 ^ u3);
+	}
+}
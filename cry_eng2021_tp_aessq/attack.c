@@ -2,12 +2,24 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
 #include <sys/time.h>
 
 #include "attack.h"
 #include "aes-128_enc.h"
+#include "aes-128_dec.h"
+#include "aes-128_engine.h"
 #include "square_crypto.h"
+#include "square_capture.h"
+#include "square_guess.h"
+#include "square_lambda.h"
+#include "square_layout.h"
+#include "square_log.h"
+#include "square_oracle.h"
+#include "square_pool.h"
+#include "square_spn.h"
 
 /*
  * Generate a lambda set with unique structure
@@ -15,28 +27,9 @@
  */
 int build_random_lambda_set(
 	uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE]) {
-	
-	// Generate base pattern using secure randomness
-	uint8_t base_pattern;
-	if (!secure_random_bytes(&base_pattern, 1)) {
-		return -1;
-	}
-
-	// Create initialization vector with base pattern
-	uint8_t init_vector[AES_BLOCK_SIZE];
-	for (int i = 0; i < AES_BLOCK_SIZE; i++) {
-		init_vector[i] = base_pattern;
-	}
-	
-	// Generate lambda set: first byte varies, others constant
-	for (size_t i = 0; i < AES_LAMBDA_SET_SIZE; i++) {
-		for (size_t j = 0; j < AES_BLOCK_SIZE; ++j) {
-			lambda_set[i][j] = init_vector[j];
-		}
-		lambda_set[i][0] = (uint8_t)i;  // Active byte position 0
-	}
-
-	return 0;
+	// Active byte position 0, random constants in the 15 others
+	return lambda_sets_random(
+		(uint8_t (*)[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE])lambda_set, 1, 0);
 }
 
 uint8_t byte_reverse_add_round_key(uint8_t block_byte, uint8_t key_byte) {
@@ -103,32 +96,306 @@ bool most_common(size_t key_byte_counter[AES_KEY_BYTES_SIZE],
 	return max_unique;
 }
 
-int aes128_attack(void) {
-	printf("=== Square Attack Implementation ===\n\n");
-	
-	// Generate random target key using secure randomness
-	uint8_t key[AES_128_KEY_SIZE] = {0};
+// Lambda-set encryption is split in chunks of this many blocks
+#define ENCRYPT_CHUNK 32
+#define ENCRYPT_CHUNKS (AES_LAMBDA_SET_SIZE / ENCRYPT_CHUNK)
 
-	if (!secure_random_bytes(key, AES_128_KEY_SIZE)) {
-		printf("Error: Failed to generate random key\n");
+// Per-worker counters, one cache line each so workers never share a line
+typedef struct {
+	size_t blocks_encrypted;
+	size_t columns_scored;
+	size_t guesses_tested;
+	char pad[64 - 3 * sizeof(size_t)];
+} worker_counters_t;
+
+struct attack_workspace {
+	size_t batch_size;
+	unsigned workers;
+	uint8_t (*lambda_sets)[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+	// Ciphertexts of each set, column-major, for the guessing stage
+	uint8_t (*columns)[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+	// Columns the guessing stage reads: ws->columns, or a mapped capture
+	const uint8_t (**set_columns)[AES_LAMBDA_SET_SIZE];
+	lambda_set_analysis_t *analyses;
+	worker_counters_t *counters;
+	attack_mode_t mode;
+	// Surviving guesses of every key byte, adaptive mode only
+	key_guess_set_t candidates[AES_128_KEY_SIZE];
+	// Set for the duration of one recovery: the simulated target's key
+	// schedule, or the oracle encrypting for us
+	const aes128_key_schedule_t *key_schedule;
+	square_oracle_t *oracle;
+	bool batch_queried;         // the whole batch went to the oracle at once
+	bool oracle_failed;
+	// Sets come from this capture, starting at capture_next, instead of
+	// being encrypted
+	const square_capture_t *capture_in;
+	size_t capture_next;
+	// Every merged set is appended here
+	square_capture_writer_t *capture_out;
+	// Variant under attack, NULL for AES
+	const spn_cipher_t *cipher;
+	// Positions already determined when the batch started are skipped
+	const size_t *possible_key_byte_count;
+};
+
+const char *attack_failure_message(attack_failure_t failure) {
+	switch (failure) {
+	case ATTACK_FAILURE_NONE:
+		return "No failure";
+	case ATTACK_FAILURE_SETUP:
+		return "Oracle, capture or thread pool unfit for the attack";
+	case ATTACK_FAILURE_RANDOM:
+		return "Lambda set generation failed";
+	case ATTACK_FAILURE_ORACLE:
+		return "Oracle query failed";
+	case ATTACK_FAILURE_NO_CANDIDATE:
+		return "A key byte lost every candidate";
+	case ATTACK_FAILURE_GAVE_UP:
+		return "No unique key after the maximum number of lambda sets";
+	case ATTACK_FAILURE_CAPTURE_END:
+		return "The capture ran out of lambda sets";
+	case ATTACK_FAILURE_CAPTURE_WRITE:
+		return "Failed to append to the capture";
+	}
+	return "Key recovery failed";
+}
+
+attack_workspace_t *attack_workspace_create(size_t batch_size, unsigned workers) {
+	attack_workspace_t *ws = calloc(1, sizeof(*ws));
+	if (!ws) {
+		return NULL;
+	}
+	ws->batch_size = batch_size ? batch_size : 1;
+	ws->workers = workers ? workers : 1;
+	ws->lambda_sets = malloc(ws->batch_size * sizeof(*ws->lambda_sets));
+	ws->columns = aligned_alloc(64, ws->batch_size * sizeof(*ws->columns));
+	ws->set_columns = malloc(ws->batch_size * sizeof(*ws->set_columns));
+	ws->analyses = malloc(ws->batch_size * sizeof(*ws->analyses));
+	ws->counters = calloc(ws->workers, sizeof(*ws->counters));
+	if (!ws->lambda_sets || !ws->columns || !ws->set_columns || !ws->analyses ||
+		!ws->counters) {
+		attack_workspace_destroy(ws);
+		return NULL;
+	}
+	return ws;
+}
+
+void attack_workspace_set_mode(attack_workspace_t *ws, attack_mode_t mode) {
+	ws->mode = mode;
+}
+
+void attack_workspace_set_capture(attack_workspace_t *ws,
+								  square_capture_writer_t *writer) {
+	ws->capture_out = writer;
+}
+
+void attack_workspace_set_cipher(attack_workspace_t *ws, const spn_cipher_t *cipher) {
+	ws->cipher = cipher;
+}
+
+/*
+ * Oracle queries an intersection attack needs on average. Each of the
+ * 16 * 255 wrong guesses survives a lambda set with probability 1/256,
+ * so P(done after k sets) = (1 - 256^-k)^(16 * 255).
+ */
+double expected_oracle_queries(void) {
+	double wrong_guesses = AES_128_KEY_SIZE * (AES_KEY_BYTES_SIZE - 1);
+	double expected_sets = 0;
+
+	for (int k = 0; k < 16; ++k) {
+		double done = k ? pow(1.0 - pow(AES_KEY_BYTES_SIZE, -k), wrong_guesses) : 0.0;
+		expected_sets += 1.0 - done;
+	}
+	return expected_sets * AES_LAMBDA_SET_SIZE;
+}
+
+void attack_workspace_destroy(attack_workspace_t *ws) {
+	if (!ws) {
+		return;
+	}
+	free(ws->lambda_sets);
+	free(ws->columns);
+	free(ws->set_columns);
+	free(ws->analyses);
+	free(ws->counters);
+	free(ws);
+}
+
+static void encrypt_task(void *arg, size_t index, unsigned worker) {
+	attack_workspace_t *ws = arg;
+	size_t set = index / ENCRYPT_CHUNKS;
+	size_t chunk = index % ENCRYPT_CHUNKS;
+
+	uint8_t (*blocks)[AES_BLOCK_SIZE] = ws->lambda_sets[set] + chunk * ENCRYPT_CHUNK;
+
+	// Encrypt lambda set through 3.5 rounds, then transpose the chunk into
+	// the columns while it is still in cache
+	if (ws->batch_queried) {
+		// Already encrypted by a single oracle query
+	} else if (ws->oracle) {
+		if (square_oracle_query(ws->oracle, blocks, ENCRYPT_CHUNK) != 0) {
+			__atomic_store_n(&ws->oracle_failed, true, __ATOMIC_RELAXED);
+		}
+		ws->counters[worker].blocks_encrypted += ENCRYPT_CHUNK;
+	} else if (ws->cipher) {
+		spn_enc_many_ks(ws->cipher, blocks, ENCRYPT_CHUNK, ws->key_schedule, 4, 0);
+		ws->counters[worker].blocks_encrypted += ENCRYPT_CHUNK;
+	} else {
+		aes128_enc_many_ks(blocks, ENCRYPT_CHUNK, ws->key_schedule, 4, 0);
+		ws->counters[worker].blocks_encrypted += ENCRYPT_CHUNK;
+	}
+	lambda_set_transpose(blocks, ENCRYPT_CHUNK, ws->columns[set], chunk * ENCRYPT_CHUNK);
+}
+
+static void guess_task(void *arg, size_t index, unsigned worker) {
+	attack_workspace_t *ws = arg;
+	size_t set = index / AES_128_KEY_SIZE;
+	size_t key_byte_index = index % AES_128_KEY_SIZE;
+
+	if (ws->possible_key_byte_count[key_byte_index] == 1) {
+		return;
+	}
+	// Reduce the column to its odd-multiplicity values, then score all
+	// 256 guesses at once, same result as distinguisher()
+	lambda_set_analysis_column(&ws->analyses[set],
+							   ws->set_columns[set], key_byte_index);
+	if (ws->mode == ATTACK_MODE_ADAPTIVE) {
+		// Only the guesses that survived the sets merged so far
+		// Many candidates are scored as all 256 guesses: count those
+		const key_guess_set_t *candidates = &ws->candidates[key_byte_index];
+		size_t scored;
+		lambda_set_analysis_guesses_within(&ws->analyses[set], key_byte_index,
+										   candidates, &scored);
+		ws->counters[worker].guesses_tested += scored;
+	} else {
+		lambda_set_analysis_guesses(&ws->analyses[set], key_byte_index);
+		ws->counters[worker].guesses_tested += AES_KEY_BYTES_SIZE;
+	}
+	ws->counters[worker].columns_scored++;
+}
+
+// Without a pool the tasks run inline as worker 0
+static void run_parallel(square_pool_t *pool, size_t count,
+						 square_task_fn fn, void *arg) {
+	if (pool) {
+		square_pool_parallel_for(pool, count, fn, arg);
+	} else {
+		for (size_t i = 0; i < count; ++i) {
+			fn(arg, i, 0);
+		}
+	}
+}
+
+/*
+ * Adaptive mode: intersect the candidates of lambda set @set into the
+ * running candidates. A key byte is found once a single guess survives.
+ * Returns -1 if a key byte lost every candidate (inconsistent ciphertexts).
+ */
+static int merge_candidates(attack_workspace_t *ws, size_t set,
+							size_t lambda_sets_used,
+							size_t possible_key_byte_count[AES_128_KEY_SIZE],
+							uint8_t decoded_key[AES_128_KEY_SIZE],
+							size_t *key_bytes_guessed) {
+	for (size_t key_byte_index = 0; key_byte_index < AES_128_KEY_SIZE;
+		 ++key_byte_index) {
+		if (possible_key_byte_count[key_byte_index] == 1) {
+			continue;
+		}
+
+		key_guess_set_t *candidates = &ws->candidates[key_byte_index];
+		const key_guess_set_t *guesses = lambda_set_analysis_guesses_within(
+			&ws->analyses[set], key_byte_index, candidates, NULL);
+		for (int w = 0; w < 4; ++w) {
+			candidates->bits[w] &= guesses->bits[w];
+		}
+
+		size_t count = key_guess_set_count(candidates);
+		SQ_LOG_EVENT(SQ_LOG_DEBUG, SQ_EV_CANDIDATES, lambda_sets_used,
+					 key_byte_index, count);
+		if (count == 0) {
+			return -1;
+		}
+		if (count == 1) {
+			for (int w = 0; w < 4; ++w) {
+				if (candidates->bits[w]) {
+					decoded_key[key_byte_index] =
+						(uint8_t)(64 * w + __builtin_ctzll(candidates->bits[w]));
+				}
+			}
+			(*key_bytes_guessed)++;
+			SQ_LOG_EVENT(SQ_LOG_DEBUG, SQ_EV_BYTE_RECOVERED, lambda_sets_used,
+						 key_byte_index, decoded_key[key_byte_index]);
+		}
+		possible_key_byte_count[key_byte_index] = count;
+	}
+
+	SQ_LOG_EVENT(SQ_LOG_INFO, SQ_EV_PROGRESS, lambda_sets_used,
+				 *key_bytes_guessed, AES_128_KEY_SIZE - *key_bytes_guessed);
+	return 0;
+}
+
+/*
+ * Generate @batch random lambda sets and encrypt them, through ws->oracle
+ * or ws->key_schedule, into ws->columns. Returns ATTACK_FAILURE_NONE or
+ * the cause of the failure.
+ */
+static attack_failure_t encrypt_batch(attack_workspace_t *ws, square_pool_t *pool,
+									  size_t batch) {
+	// Lambda sets with unique structure, active at byte 0
+	if (lambda_sets_random(ws->lambda_sets, batch, 0) != 0) {
+		return ATTACK_FAILURE_RANDOM;
+	}
+	for (size_t set = 0; set < batch; ++set) {
+		ws->set_columns[set] = (const uint8_t (*)[AES_LAMBDA_SET_SIZE])ws->columns[set];
+	}
+
+	// An oracle that can't be shared between workers gets the whole
+	// batch in one round trip
+	ws->batch_queried = ws->oracle && !ws->oracle->concurrent;
+	if (ws->batch_queried) {
+		if (square_oracle_query(ws->oracle, ws->lambda_sets[0],
+								batch * AES_LAMBDA_SET_SIZE) != 0) {
+			return ATTACK_FAILURE_ORACLE;
+		}
+		ws->counters[0].blocks_encrypted += batch * AES_LAMBDA_SET_SIZE;
+	}
+	ws->oracle_failed = false;
+	run_parallel(pool, batch * ENCRYPT_CHUNKS, encrypt_task, ws);
+	return ws->oracle_failed ? ATTACK_FAILURE_ORACLE : ATTACK_FAILURE_NONE;
+}
+
+/*
+ * The attack itself, over a capture or encrypting through ws->oracle or
+ * ws->key_schedule.
+ * Fills everything in @trial but the key and the success flag.
+ */
+static int run_attack(attack_workspace_t *ws, square_pool_t *pool,
+					  attack_trial_t *trial) {
+	trial->failure = ATTACK_FAILURE_NONE;
+	if (pool && square_pool_size(pool) > ws->workers) {
+		// Not enough per-worker counters for this pool
+		trial->failure = ATTACK_FAILURE_SETUP;
 		return -1;
 	}
 
+	memset(ws->counters, 0, ws->workers * sizeof(*ws->counters));
+
 	// Decoded key after the attack
 	uint8_t decoded_key[AES_128_KEY_SIZE] = {0};
-	// Lambda set
-	uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE] = {{0}};
 	// Counts the occurence of possible key bytes for all key bytes index
 	// It is shared accross lambda sets.
 	size_t key_bytes_counter[AES_128_KEY_SIZE][AES_KEY_BYTES_SIZE] = {{0}};
 	// Counts the number of possible keys for a given byte
 	size_t possible_key_byte_count[AES_128_KEY_SIZE] = {0};
+	ws->possible_key_byte_count = possible_key_byte_count;
+	memset(ws->candidates, 0xff, sizeof(ws->candidates));
 
 	// counts the number of possible key byte guesses for a lambda set
 	size_t key_byte_count;
 	// holds the last possible key byte guess. When key_byte_count is equals to
 	// 1, it holds the only possible key byte guess ie. the correct key byte.
-	uint8_t guessed_key_byte;
+	uint8_t guessed_key_byte = 0;
 
 	// Track attack progress with timing
 	double start_time = get_timestamp_ms();
@@ -137,125 +404,572 @@ int aes128_attack(void) {
 	// Storage for key recovery analysis
 	size_t key_bytes_guessed = 0;
 	
+	// One lambda set per worker is generated, encrypted and scored in
+	// parallel, then the results are merged in order. Sets past the one
+	// that completes the key are discarded and not counted.
+	const uint8_t *sbox_inv = ws->cipher ? ws->cipher->sbox_inv : Sinv;
 	while (key_bytes_guessed < AES_128_KEY_SIZE) {
-		lambda_sets_used++;
-		
-		// Generate lambda set with unique structure
-		int generation_result = build_random_lambda_set(lambda_set);
-		if (generation_result != 0) {
-			printf("Error: Lambda set generation failed\n");
-			return -1;
+		if (lambda_sets_used >= ATTACK_MAX_LAMBDA_SETS) {
+			// A variant the distinguisher does not hold for never converges
+			trial->failure = ATTACK_FAILURE_GAVE_UP;
+			goto fail;
+		}
+		// The adaptive mode only queries the sets it expects to need: almost
+		// every key takes two, then one more at a time
+		size_t batch = ws->batch_size;
+		if (ws->mode == ATTACK_MODE_ADAPTIVE) {
+			size_t wanted = lambda_sets_used == 0 ? 2 : 1;
+			batch = wanted < batch ? wanted : batch;
 		}
 
-		// Encrypt lambda set through 3.5 rounds
-		for (size_t i = 0; i < AES_LAMBDA_SET_SIZE; ++i) {
-			aes128_enc(lambda_set[i], key, 4, 0);
+		if (ws->capture_in) {
+			// Zero copy: the guessing stage reads the mapped columns
+			size_t first = ws->capture_next + lambda_sets_used;
+			size_t left = square_capture_count(ws->capture_in) - first;
+			if (left == 0) {
+				trial->failure = ATTACK_FAILURE_CAPTURE_END;
+				goto fail;
+			}
+			batch = left < batch ? left : batch;
+			for (size_t set = 0; set < batch; ++set) {
+				ws->set_columns[set] = square_capture_set(ws->capture_in, first + set);
+			}
+		} else if ((trial->failure = encrypt_batch(ws, pool, batch)) != ATTACK_FAILURE_NONE) {
+			goto fail;
+		}
+		for (size_t set = 0; set < batch; ++set) {
+			lambda_set_analysis_reset(&ws->analyses[set], sbox_inv);
 		}
+		run_parallel(pool, batch * AES_128_KEY_SIZE, guess_task, ws);
 
-		// Loop through the key bytes we try to guess
-		for (size_t key_byte_index = 0; key_byte_index < AES_128_KEY_SIZE;
-			 ++key_byte_index) {
-			if (possible_key_byte_count[key_byte_index] == 1) {
-				// The key byte was already found
-				continue;
+		for (size_t set = 0; set < batch &&
+			 key_bytes_guessed < AES_128_KEY_SIZE; ++set) {
+			lambda_sets_used++;
+			if (ws->capture_out &&
+				square_capture_append(ws->capture_out, ws->set_columns[set]) != 0) {
+				trial->failure = ATTACK_FAILURE_CAPTURE_WRITE;
+				goto fail;
 			}
 
-			// (Re-)Initialize the count of key byte guesses for the current key
-			// byte
-			key_byte_count = 0;
-			printf("Possible guess for byte %zu :", key_byte_index);
-			for (uint16_t key_byte = 0; key_byte < AES_KEY_BYTES_SIZE;
-				 ++key_byte) {
-				if (distinguisher(lambda_set, key_byte_index, (uint8_t)key_byte,
-								  Sinv)) {
-					printf(" %x -", key_byte);
-					// Increment the possible guesses counter for the next
-					// iteration with a new lambda set
-					key_bytes_counter[key_byte_index][key_byte]++;
-					// Increment the possible guesses counter for the current
-					// lambda set
-					key_byte_count++;
-					// Save the last guessed byte, used if there is only one
-					// guess for this key byte
-					guessed_key_byte = (uint8_t)key_byte;
+			if (ws->mode == ATTACK_MODE_ADAPTIVE) {
+				if (merge_candidates(ws, set, lambda_sets_used,
+									 possible_key_byte_count, decoded_key,
+									 &key_bytes_guessed) != 0) {
+					trial->failure = ATTACK_FAILURE_NO_CANDIDATE;
+					goto fail;
 				}
+				continue;
 			}
-			printf("\n");
-
-			printf("Possible keys count : %zu \n", key_byte_count);
-			if (key_byte_count == 1) {
-				// There is only one guessed key byte, it is the correct key
-				// byte
-				decoded_key[key_byte_index] = guessed_key_byte;
-				key_bytes_guessed++;
-			} else if (possible_key_byte_count[key_byte_index] > 0) {
-				// There are many key bytes guesses and we aren't using the
-				// first lambda set
-
-				if (most_common(key_bytes_counter[key_byte_index],
-								&guessed_key_byte)) {
-					// There is only one most common occurrence, we found the
-					// correct key byte
+
+			// Loop through the key bytes we try to guess
+			for (size_t key_byte_index = 0; key_byte_index < AES_128_KEY_SIZE;
+				 ++key_byte_index) {
+				if (possible_key_byte_count[key_byte_index] == 1) {
+					// The key byte was already found
+					continue;
+				}
+
+				// (Re-)Initialize the count of key byte guesses for the current
+				// key byte
+				key_byte_count = 0;
+				const key_guess_set_t *guesses =
+					lambda_set_analysis_guesses(&ws->analyses[set], key_byte_index);
+				for (uint16_t key_byte = 0; key_byte < AES_KEY_BYTES_SIZE;
+					 ++key_byte) {
+					if (key_guess_set_has(guesses, (uint8_t)key_byte)) {
+						SQ_LOG_EVENT(SQ_LOG_TRACE, SQ_EV_GUESS, lambda_sets_used,
+									 key_byte_index, key_byte);
+						// Increment the possible guesses counter for the next
+						// iteration with a new lambda set
+						key_bytes_counter[key_byte_index][key_byte]++;
+						// Increment the possible guesses counter for the
+						// current lambda set
+						key_byte_count++;
+						// Save the last guessed byte, used if there is only
+						// one guess for this key byte
+						guessed_key_byte = (uint8_t)key_byte;
+					}
+				}
+				SQ_LOG_EVENT(SQ_LOG_DEBUG, SQ_EV_CANDIDATES, lambda_sets_used,
+							 key_byte_index, key_byte_count);
+				if (key_byte_count == 1) {
+					// There is only one guessed key byte, it is the correct
+					// key byte
 					decoded_key[key_byte_index] = guessed_key_byte;
-					key_byte_count = 1;
 					key_bytes_guessed++;
+					SQ_LOG_EVENT(SQ_LOG_DEBUG, SQ_EV_BYTE_RECOVERED, lambda_sets_used,
+								 key_byte_index, guessed_key_byte);
+				} else if (possible_key_byte_count[key_byte_index] > 0) {
+					// There are many key bytes guesses and we aren't using the
+					// first lambda set
+
+					if (most_common(key_bytes_counter[key_byte_index],
+									&guessed_key_byte)) {
+						// There is only one most common occurrence, we found
+						// the correct key byte
+						decoded_key[key_byte_index] = guessed_key_byte;
+						key_byte_count = 1;
+						key_bytes_guessed++;
+						SQ_LOG_EVENT(SQ_LOG_DEBUG, SQ_EV_BYTE_RECOVERED,
+									 lambda_sets_used, key_byte_index,
+									 guessed_key_byte);
+					}
 				}
+
+				possible_key_byte_count[key_byte_index] = key_byte_count;
 			}
 
-			possible_key_byte_count[key_byte_index] = key_byte_count;
+			SQ_LOG_EVENT(SQ_LOG_INFO, SQ_EV_PROGRESS, lambda_sets_used,
+						 key_bytes_guessed, AES_128_KEY_SIZE - key_bytes_guessed);
 		}
+	}
+
+	// Records are only formatted here, outside the loop
+	square_log_flush();
 
-		printf("\nProgress Report:\n");
-		printf("Key bytes recovered: %zu/%d\n", key_bytes_guessed, AES_128_KEY_SIZE);
-		printf("Lambda sets used: %zu\n", lambda_sets_used);
-		printf("Remaining bytes: %zu\n\n", AES_128_KEY_SIZE - key_bytes_guessed);
+	// Derive master key using key schedule inversion
+	uint8_t tmp[AES_128_KEY_SIZE];
+
+	memcpy(trial->round_key, decoded_key, AES_128_KEY_SIZE);
+	if (ws->cipher) {
+		spn_prev_round_key(ws->cipher, decoded_key, tmp, 3);
+		spn_prev_round_key(ws->cipher, tmp, decoded_key, 2);
+		spn_prev_round_key(ws->cipher, decoded_key, tmp, 1);
+		spn_prev_round_key(ws->cipher, tmp, decoded_key, 0);
+	} else {
+		aes128_key_schedule_t ks;
+		aes128_expand_key_from_round(&ks, decoded_key, 4);
+		memcpy(decoded_key, ks.rk[0], AES_128_KEY_SIZE);
 	}
 
-	// Display final results with timing
-	double execution_time = get_timestamp_ms() - start_time;
+	memcpy(trial->recovered_key, decoded_key, AES_128_KEY_SIZE);
+	trial->execution_time = get_timestamp_ms() - start_time;
+	trial->lambda_sets_used = lambda_sets_used;
+
+	// Merge the per-worker counters
+	trial->blocks_encrypted = 0;
+	trial->columns_scored = 0;
+	trial->guesses_tested = 0;
+	for (unsigned worker = 0; worker < ws->workers; ++worker) {
+		trial->blocks_encrypted += ws->counters[worker].blocks_encrypted;
+		trial->columns_scored += ws->counters[worker].columns_scored;
+		trial->guesses_tested += ws->counters[worker].guesses_tested;
+	}
+
+	return 0;
+
+fail:
+	// The events up to the failure are what explains it
+	square_log_flush();
+	return -1;
+}
+
+int recover_key(attack_workspace_t *ws, square_pool_t *pool,
+				const uint8_t key[AES_128_KEY_SIZE], attack_trial_t *trial) {
+	// Expanded once, reused for every lambda set
+	aes128_key_schedule_t key_schedule;
+	if (ws->cipher) {
+		spn_expand_key(ws->cipher, &key_schedule, key);
+	} else {
+		aes128_expand_key(&key_schedule, key);
+	}
+	ws->key_schedule = &key_schedule;
+	ws->oracle = NULL;
+	ws->capture_in = NULL;
+
+	int status = run_attack(ws, pool, trial);
+	if (status == 0) {
+		memcpy(trial->key, key, AES_128_KEY_SIZE);
+		trial->success = arrays_match(trial->recovered_key, key, AES_128_KEY_SIZE);
+	}
+	return status;
+}
+
+int recover_key_oracle(attack_workspace_t *ws, square_pool_t *pool,
+					   square_oracle_t *oracle, attack_trial_t *trial) {
+	if (oracle->nrounds != 4 || oracle->lastfull) {
+		// The distinguisher needs 3.5-round ciphertexts
+		trial->failure = ATTACK_FAILURE_SETUP;
+		return -1;
+	}
+	ws->key_schedule = NULL;
+	ws->oracle = oracle;
+	ws->capture_in = NULL;
+
+	int status = run_attack(ws, pool, trial);
+	ws->oracle = NULL;
+	if (status != 0) {
+		return status;
+	}
+
+	// The key is unknown: check the recovered one against one more query
+	uint8_t block[AES_BLOCK_SIZE];
+	uint8_t expected[AES_BLOCK_SIZE];
+	if (!secure_random_bytes(block, AES_BLOCK_SIZE)) {
+		trial->failure = ATTACK_FAILURE_RANDOM;
+		return -1;
+	}
+	memcpy(expected, block, AES_BLOCK_SIZE);
+	if (ws->cipher) {
+		aes128_key_schedule_t key_schedule;
+		spn_expand_key(ws->cipher, &key_schedule, trial->recovered_key);
+		spn_enc_many_ks(ws->cipher, &expected, 1, &key_schedule, 4, 0);
+	} else {
+		aes128_enc(expected, trial->recovered_key, 4, 0);
+	}
+	if (square_oracle_query(oracle, &block, 1) != 0) {
+		trial->failure = ATTACK_FAILURE_ORACLE;
+		return -1;
+	}
+	trial->blocks_encrypted++;
+	memset(trial->key, 0, AES_128_KEY_SIZE);
+	trial->success = arrays_match(block, expected, AES_BLOCK_SIZE);
+	return 0;
+}
+
+int recover_key_capture(attack_workspace_t *ws, square_pool_t *pool,
+						const square_capture_t *capture, size_t *next,
+						attack_trial_t *trial) {
+	const square_capture_header_t *header = square_capture_header(capture);
+	if (header->nrounds != 4 || header->lastfull ||
+		__builtin_popcount(header->active_mask) != 1) {
+		// The distinguisher needs 3.5-round ciphertexts of single-byte sets
+		trial->failure = ATTACK_FAILURE_SETUP;
+		return -1;
+	}
+	ws->key_schedule = NULL;
+	ws->oracle = NULL;
+	ws->capture_in = capture;
+	ws->capture_next = *next;
+
+	int status = run_attack(ws, pool, trial);
+	ws->capture_in = NULL;
+	if (status != 0) {
+		return status;
+	}
+	// Nothing to check the key against: the caller compares recoveries
+	*next += trial->lambda_sets_used;
+	memset(trial->key, 0, AES_128_KEY_SIZE);
+	trial->blocks_encrypted = 0;
+	trial->success = true;
+	return 0;
+}
+
+int aes128_capture(square_pool_t *pool, square_oracle_t *oracle, size_t sets,
+				   const char *path) {
+	unsigned workers = square_pool_size(pool);
+	attack_workspace_t *ws = attack_workspace_create(workers, workers);
+	square_capture_writer_t *writer = square_capture_create(path, oracle->nrounds,
+															oracle->lastfull, 1);
+	int status = -1;
+
+	if (!ws || !writer) {
+		fprintf(stderr, "Error: Failed to create capture %s\n", path);
+		goto out;
+	}
+	ws->oracle = oracle;
+	memset(ws->counters, 0, ws->workers * sizeof(*ws->counters));
+
+	double start_time = get_timestamp_ms();
+	for (size_t done = 0; done < sets; ) {
+		size_t batch = sets - done < ws->batch_size ? sets - done : ws->batch_size;
+		attack_failure_t failure = encrypt_batch(ws, pool, batch);
+		if (failure != ATTACK_FAILURE_NONE) {
+			fprintf(stderr, "Error: %s\n", attack_failure_message(failure));
+			goto out;
+		}
+		for (size_t set = 0; set < batch; ++set) {
+			if (square_capture_append(writer, ws->set_columns[set]) != 0) {
+				fprintf(stderr, "Error: Failed to write %s\n", path);
+				goto out;
+			}
+		}
+		done += batch;
+	}
+	double wall_time = get_timestamp_ms() - start_time;
+	fprintf(stderr, "Captured %zu lambda sets (%.1f MiB) in %.2f ms\n", sets,
+			(double)sets * SQUARE_CAPTURE_SET_SIZE / (1024.0 * 1024.0), wall_time);
+	status = 0;
+
+out:
+	if (square_capture_close(writer) != 0) {
+		status = -1;
+	}
+	attack_workspace_destroy(ws);
+	return status;
+}
+
+int aes128_analyze_capture(square_pool_t *pool, attack_mode_t mode, const char *path) {
+	square_capture_t *capture = square_capture_open(path);
+	if (!capture) {
+		fprintf(stderr, "Error: %s is not a readable capture\n", path);
+		return -1;
+	}
+
+	unsigned workers = square_pool_size(pool);
+	attack_workspace_t *ws = attack_workspace_create(workers, workers);
+	if (!ws) {
+		fprintf(stderr, "Error: Out of memory\n");
+		square_capture_unmap(capture);
+		return -1;
+	}
+	attack_workspace_set_mode(ws, mode);
+
+	// Back-to-back recoveries over consecutive sets until the capture runs out
+	size_t next = 0;
+	size_t recoveries = 0;
+	size_t mismatches = 0;
+	uint8_t first_key[AES_128_KEY_SIZE] = {0};
+	attack_trial_t trial;
+	double start_time = get_timestamp_ms();
+	while (recover_key_capture(ws, pool, capture, &next, &trial) == 0) {
+		if (recoveries == 0) {
+			memcpy(first_key, trial.recovered_key, AES_128_KEY_SIZE);
+		} else if (!arrays_match(first_key, trial.recovered_key, AES_128_KEY_SIZE)) {
+			mismatches++;
+		}
+		recoveries++;
+	}
+	double wall_time = get_timestamp_ms() - start_time;
+	attack_workspace_destroy(ws);
+	if (trial.failure != ATTACK_FAILURE_CAPTURE_END) {
+		// Running out of sets is the normal end, anything else is reported
+		fprintf(stderr, "Error: %s\n", attack_failure_message(trial.failure));
+	}
+
+	double bytes = (double)next * SQUARE_CAPTURE_SET_SIZE;
+	printf("=== Capture Analysis ===\n");
+	printf("Lambda sets: %zu used of %zu\n", next, square_capture_count(capture));
+	printf("Recoveries: %zu (%zu disagree with the first)\n", recoveries, mismatches);
+	if (recoveries) {
+		format_hex_output(first_key, AES_128_KEY_SIZE, "Recovered Master Key");
+	}
+	printf("Time: %.2f ms, %.2f keys/s, %.1f MiB/s\n", wall_time,
+		   wall_time > 0 ? recoveries * 1000.0 / wall_time : 0.0,
+		   wall_time > 0 ? bytes / (1024.0 * 1024.0) / (wall_time / 1000.0) : 0.0);
+	square_capture_unmap(capture);
+	return recoveries && !mismatches ? 0 : 1;
+}
+
+int aes128_attack(square_pool_t *pool, attack_mode_t mode, square_oracle_t *oracle,
+				  const char *capture_path) {
+	printf("=== Square Attack Implementation ===\n\n");
 	
+	// Generate random target key using secure randomness
+	uint8_t key[AES_128_KEY_SIZE] = {0};
+
+	if (!oracle && !secure_random_bytes(key, AES_128_KEY_SIZE)) {
+		printf("Error: Failed to generate random key\n");
+		return -1;
+	}
+
+	unsigned workers = square_pool_size(pool);
+	attack_workspace_t *ws = attack_workspace_create(workers, workers);
+	if (!ws) {
+		printf("Error: Out of memory\n");
+		return -1;
+	}
+	attack_workspace_set_mode(ws, mode);
+
+	square_capture_writer_t *writer = NULL;
+	if (capture_path) {
+		writer = square_capture_create(capture_path, oracle ? oracle->nrounds : 4,
+									   oracle ? oracle->lastfull : 0, 1);
+		if (!writer) {
+			printf("Error: Failed to create capture %s\n", capture_path);
+			attack_workspace_destroy(ws);
+			return -1;
+		}
+		attack_workspace_set_capture(ws, writer);
+	}
+
+	attack_trial_t trial;
+	int status = oracle ? recover_key_oracle(ws, pool, oracle, &trial)
+						: recover_key(ws, pool, key, &trial);
+	attack_workspace_destroy(ws);
+	if (square_capture_close(writer) != 0 && status == 0) {
+		printf("Error: Failed to write capture %s\n", capture_path);
+		return -1;
+	}
+	if (status != 0) {
+		printf("Error: %s\n", attack_failure_message(trial.failure));
+		return -1;
+	}
+
+	// Display final results with timing
 	printf("=== Attack Results ===\n");
-	format_hex_output(key, AES_128_KEY_SIZE, "Original Key");
+	if (oracle) {
+		printf("Original Key        : held by the %s oracle\n", oracle->name);
+	} else {
+		format_hex_output(key, AES_128_KEY_SIZE, "Original Key");
+	}
 
 	printf("\nDeriving master key from recovered 3rd round key...\n");
-	format_hex_output(decoded_key, AES_128_KEY_SIZE, "3rd Round Key");
+	format_hex_output(trial.round_key, AES_128_KEY_SIZE, "3rd Round Key");
+	format_hex_output(trial.recovered_key, AES_128_KEY_SIZE, "Recovered Master Key");
 
-	// Derive master key using key schedule inversion
-	uint8_t tmp[AES_128_KEY_SIZE];
-	
-	prev_aes128_round_key(decoded_key, tmp, 3);
-	prev_aes128_round_key(tmp, decoded_key, 2);
-	prev_aes128_round_key(decoded_key, tmp, 1);
-	prev_aes128_round_key(tmp, decoded_key, 0);
+	printf("\n=== Attack Summary ===\n");
+	printf("Execution time: %.2f ms\n", trial.execution_time);
+	printf("Lambda sets used: %zu\n", trial.lambda_sets_used);
+	printf("Worker threads: %u\n", workers);
+	printf("Blocks encrypted: %zu\n", trial.blocks_encrypted);
+	printf("Columns scored: %zu\n", trial.columns_scored);
+	printf("Guesses tested: %zu\n", trial.guesses_tested);
+	printf("Oracle queries: %zu (expected %.1f)\n", trial.blocks_encrypted,
+		   expected_oracle_queries());
+	if (oracle) {
+		printf("Oracle round trips: %llu\n", (unsigned long long)oracle->round_trips);
+	}
+	printf("Success: %s%s\n", trial.success ? "YES" : "NO",
+		   oracle ? " (checked with one more query)" : "");
 
-	format_hex_output(decoded_key, AES_128_KEY_SIZE, "Recovered Master Key");
+	return trial.success ? 0 : 1;
+}
 
-	// Verify attack success
-	bool attack_success = arrays_match(decoded_key, key, AES_128_KEY_SIZE);
-	
-	printf("\n=== Attack Summary ===\n");
-	printf("Execution time: %.2f ms\n", execution_time);
-	printf("Lambda sets used: %zu\n", lambda_sets_used);
-	printf("Success: %s\n", attack_success ? "YES" : "NO");
+// Campaign state shared by the trial tasks
+typedef struct {
+	attack_trial_t *trials;
+	attack_workspace_t **workspaces;   // one per worker, reused across trials
+	int *status;
+} campaign_t;
 
-	return attack_success ? 0 : 1;
+static void campaign_task(void *arg, size_t index, unsigned worker) {
+	campaign_t *campaign = arg;
+	uint8_t key[AES_128_KEY_SIZE];
+
+	if (!secure_random_bytes(key, AES_128_KEY_SIZE)) {
+		campaign->status[index] = -1;
+		return;
+	}
+	// Each trial runs single-threaded: parallelism comes from the trials
+	campaign->status[index] = recover_key(campaign->workspaces[worker], NULL,
+										  key, &campaign->trials[index]);
 }
 
-int main() {
-	printf("Square Cryptanalysis Framework\n");
-	printf("==============================\n");
-	printf("3.5-round AES-128 Key Recovery Attack\n\n");
-	
-	int result = aes128_attack();
-	
-	printf("\n=== Final Status ===\n");
-	if (result == 0) {
-		printf("Attack completed successfully!\n");
-		printf("Master key recovered with 100%% accuracy.\n");
+static void hex_string(const uint8_t *data, size_t length, char *out) {
+	for (size_t i = 0; i < length; ++i) {
+		sprintf(out + 2 * i, "%02x", data[i]);
+	}
+}
+
+int aes128_campaign(square_pool_t *pool, size_t trials, attack_mode_t mode,
+					campaign_format_t format, FILE *out) {
+	unsigned workers = square_pool_size(pool);
+	campaign_t campaign;
+	int result = -1;
+
+	campaign.trials = calloc(trials, sizeof(*campaign.trials));
+	campaign.status = calloc(trials, sizeof(*campaign.status));
+	campaign.workspaces = calloc(workers, sizeof(*campaign.workspaces));
+	if (!campaign.trials || !campaign.status || !campaign.workspaces) {
+		fprintf(stderr, "Error: Out of memory\n");
+		goto out;
+	}
+	for (unsigned worker = 0; worker < workers; ++worker) {
+		campaign.workspaces[worker] = attack_workspace_create(1, 1);
+		if (!campaign.workspaces[worker]) {
+			fprintf(stderr, "Error: Out of memory\n");
+			goto out;
+		}
+		attack_workspace_set_mode(campaign.workspaces[worker], mode);
+	}
+
+	double start_time = get_timestamp_ms();
+	square_pool_parallel_for(pool, trials, campaign_task, &campaign);
+	double wall_time = get_timestamp_ms() - start_time;
+
+	// Aggregate statistics
+	size_t failures = 0;
+	size_t errors = 0;
+	size_t total_sets = 0;
+	size_t max_sets = 0;
+	size_t total_queries = 0;
+	size_t total_guesses = 0;
+	for (size_t i = 0; i < trials; ++i) {
+		if (campaign.status[i] != 0) {
+			errors++;
+			failures++;
+			continue;
+		}
+		if (!campaign.trials[i].success) {
+			failures++;
+		}
+		total_sets += campaign.trials[i].lambda_sets_used;
+		total_queries += campaign.trials[i].blocks_encrypted;
+		total_guesses += campaign.trials[i].guesses_tested;
+		if (campaign.trials[i].lambda_sets_used > max_sets) {
+			max_sets = campaign.trials[i].lambda_sets_used;
+		}
+	}
+	size_t completed = trials - errors;
+	double mean_sets = completed ? (double)total_sets / (double)completed : 0.0;
+	double mean_queries = completed ? (double)total_queries / (double)completed : 0.0;
+	double mean_guesses = completed ? (double)total_guesses / (double)completed : 0.0;
+	const char *mode_name = mode == ATTACK_MODE_ADAPTIVE ? "adaptive" : "voting";
+	double keys_per_second = wall_time > 0 ? (double)trials * 1000.0 / wall_time : 0.0;
+	double failure_rate = trials ? (double)failures / (double)trials : 0.0;
+
+	char key_hex[2 * AES_128_KEY_SIZE + 1];
+	char recovered_hex[2 * AES_128_KEY_SIZE + 1];
+
+	if (format == CAMPAIGN_FORMAT_JSON) {
+		fprintf(out, "{\n  \"summary\": {\"trials\": %zu, \"threads\": %u, "
+				"\"mode\": \"%s\", "
+				"\"wall_time_ms\": %.3f, \"keys_per_second\": %.2f, "
+				"\"mean_lambda_sets\": %.4f, \"max_lambda_sets\": %zu, "
+				"\"mean_oracle_queries\": %.2f, \"expected_oracle_queries\": %.2f, "
+				"\"mean_guesses_tested\": %.2f, "
+				"\"failures\": %zu, \"errors\": %zu, \"failure_rate\": %.6f},\n",
+				trials, workers, mode_name, wall_time, keys_per_second, mean_sets,
+				max_sets, mean_queries, expected_oracle_queries(), mean_guesses,
+				failures, errors, failure_rate);
+		fprintf(out, "  \"trials\": [");
+		for (size_t i = 0; i < trials; ++i) {
+			const attack_trial_t *trial = &campaign.trials[i];
+			hex_string(trial->key, AES_128_KEY_SIZE, key_hex);
+			hex_string(trial->recovered_key, AES_128_KEY_SIZE, recovered_hex);
+			fprintf(out, "%s\n    {\"trial\": %zu, \"status\": %d, \"key\": \"%s\", "
+					"\"recovered_key\": \"%s\", \"lambda_sets\": %zu, "
+					"\"oracle_queries\": %zu, \"guesses_tested\": %zu, "
+					"\"time_ms\": %.4f, \"success\": %s}",
+					i ? "," : "", i, campaign.status[i], key_hex, recovered_hex,
+					trial->lambda_sets_used, trial->blocks_encrypted,
+					trial->guesses_tested, trial->execution_time,
+					trial->success ? "true" : "false");
+		}
+		fprintf(out, "\n  ]\n}\n");
 	} else {
-		printf(" Attack incomplete or failed.\n");
-		printf("Error code: %d\n", result);
+		fprintf(out, "trial,status,key,recovered_key,lambda_sets,oracle_queries,"
+				"guesses_tested,time_ms,success\n");
+		for (size_t i = 0; i < trials; ++i) {
+			const attack_trial_t *trial = &campaign.trials[i];
+			hex_string(trial->key, AES_128_KEY_SIZE, key_hex);
+			hex_string(trial->recovered_key, AES_128_KEY_SIZE, recovered_hex);
+			fprintf(out, "%zu,%d,%s,%s,%zu,%zu,%zu,%.4f,%d\n", i, campaign.status[i],
+					key_hex, recovered_hex, trial->lambda_sets_used,
+					trial->blocks_encrypted, trial->guesses_tested,
+					trial->execution_time, trial->success ? 1 : 0);
+		}
+		fprintf(stderr, "Trials: %zu on %u threads in %.2f ms (%s)\n",
+				trials, workers, wall_time, mode_name);
+		fprintf(stderr, "Throughput: %.2f keys/s\n", keys_per_second);
+		fprintf(stderr, "Lambda sets: mean %.3f, max %zu\n", mean_sets, max_sets);
+		fprintf(stderr, "Oracle queries: mean %.1f, expected %.1f\n",
+				mean_queries, expected_oracle_queries());
+		fprintf(stderr, "Guesses tested: mean %.1f\n", mean_guesses);
+		fprintf(stderr, "Failure rate: %.4f (%zu failures, %zu errors)\n",
+				failure_rate, failures, errors);
 	}
-	
+	result = failures ? 1 : 0;
+
+out:
+	if (campaign.workspaces) {
+		for (unsigned worker = 0; worker < workers; ++worker) {
+			attack_workspace_destroy(campaign.workspaces[worker]);
+		}
+	}
+	free(campaign.workspaces);
+	free(campaign.trials);
+	free(campaign.status);
 	return result;
-}
\ No newline at end of file
+}
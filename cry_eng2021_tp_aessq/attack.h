@@ -1,13 +1,65 @@
 #ifndef ATTACK_H
 #define ATTACK_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+
+#include "square_oracle.h"
+#include "square_pool.h"
 
 // Constants
 #define AES_BLOCK_SIZE 16
 #define AES_LAMBDA_SET_SIZE 256
 #define AES_KEY_BYTES_SIZE 256
+// Lambda sets one recovery may use before giving up
+#define ATTACK_MAX_LAMBDA_SETS 64
+
+// Why a key recovery returned -1
+typedef enum {
+	ATTACK_FAILURE_NONE = 0,
+	ATTACK_FAILURE_SETUP,           // pool, oracle or capture unfit for the attack
+	ATTACK_FAILURE_RANDOM,          // no randomness for the lambda sets
+	ATTACK_FAILURE_ORACLE,          // an oracle query failed
+	ATTACK_FAILURE_NO_CANDIDATE,    // a key byte lost every candidate
+	ATTACK_FAILURE_GAVE_UP,         // ATTACK_MAX_LAMBDA_SETS sets without converging
+	ATTACK_FAILURE_CAPTURE_END,     // the capture ran out of lambda sets
+	ATTACK_FAILURE_CAPTURE_WRITE    // appending to the output capture failed
+} attack_failure_t;
+
+// Outcome of one key recovery
+typedef struct {
+	uint8_t key[AES_BLOCK_SIZE];
+	uint8_t round_key[AES_BLOCK_SIZE];      // recovered 4th round key
+	uint8_t recovered_key[AES_BLOCK_SIZE];  // master key derived from it
+	size_t lambda_sets_used;
+	size_t blocks_encrypted;                // oracle queries, discarded sets included
+	size_t columns_scored;
+	size_t guesses_tested;
+	double execution_time;
+	attack_failure_t failure;               // set when the recovery fails
+	bool success;
+} attack_trial_t;
+
+typedef enum {
+	ATTACK_MODE_VOTING,      // most_common() over the votes of every lambda set
+	ATTACK_MODE_ADAPTIVE     // intersect candidates, later sets test only survivors
+} attack_mode_t;
+
+typedef enum {
+	CAMPAIGN_FORMAT_CSV,
+	CAMPAIGN_FORMAT_JSON
+} campaign_format_t;
+
+// Lambda-set buffers reused from one recovery to the next
+typedef struct attack_workspace attack_workspace_t;
+
+// Defined in square_capture.h
+typedef struct square_capture square_capture_t;
+typedef struct square_capture_writer square_capture_writer_t;
+// Defined in square_spn.h
+typedef struct spn_cipher spn_cipher_t;
 
 // Function declarations
 int build_random_lambda_set(uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE]);
@@ -18,6 +70,30 @@ bool distinguisher(uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE],
                    size_t key_byte_index, uint8_t guessed_key_byte,
                    const uint8_t Sbox_inv[256]);
 bool most_common(size_t key_byte_counter[AES_KEY_BYTES_SIZE], uint8_t *guessed_key_byte);
-int aes128_attack(void);
+const char *attack_failure_message(attack_failure_t failure);
+attack_workspace_t *attack_workspace_create(size_t batch_size, unsigned workers);
+void attack_workspace_destroy(attack_workspace_t *ws);
+void attack_workspace_set_mode(attack_workspace_t *ws, attack_mode_t mode);
+// Append every lambda set a recovery uses to @writer, NULL to stop
+void attack_workspace_set_capture(attack_workspace_t *ws,
+                                  square_capture_writer_t *writer);
+// Attack the AES variant @cipher instead of AES, NULL for AES
+void attack_workspace_set_cipher(attack_workspace_t *ws, const spn_cipher_t *cipher);
+double expected_oracle_queries(void);
+int recover_key(attack_workspace_t *ws, square_pool_t *pool,
+                const uint8_t key[AES_BLOCK_SIZE], attack_trial_t *trial);
+int recover_key_oracle(attack_workspace_t *ws, square_pool_t *pool,
+                       square_oracle_t *oracle, attack_trial_t *trial);
+// Recover a key from the capture sets starting at *next, advanced past them
+int recover_key_capture(attack_workspace_t *ws, square_pool_t *pool,
+                        const square_capture_t *capture, size_t *next,
+                        attack_trial_t *trial);
+int aes128_attack(square_pool_t *pool, attack_mode_t mode, square_oracle_t *oracle,
+                  const char *capture_path);
+int aes128_capture(square_pool_t *pool, square_oracle_t *oracle, size_t sets,
+                   const char *path);
+int aes128_analyze_capture(square_pool_t *pool, attack_mode_t mode, const char *path);
+int aes128_campaign(square_pool_t *pool, size_t trials, attack_mode_t mode,
+                    campaign_format_t format, FILE *out);
 
 #endif // ATTACK_H
\ No newline at end of file
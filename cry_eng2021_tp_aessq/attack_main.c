@@ -0,0 +1,275 @@
+/*
+ * Square attack command line driver
+ * Single interactive key recovery, campaign of many trials, or capture
+ * and analysis of recorded lambda sets
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "attack.h"
+#include "square_crypto.h"
+#include "square_extend.h"
+#include "square_log.h"
+#include "square_oracle.h"
+#include "square_pool.h"
+#include "square_random.h"
+
+static void usage(const char *prog) {
+	fprintf(stderr, "Usage: %s [-t threads] [-a] [-v...] [-T trace] [-O oracle] [-R file]"
+			" [-C capture] [-s seed]\n"
+			"       %s -n trials [-f csv|json] [-o file] [-t threads] [-a]\n"
+			"       %s -S sets -C capture [-t threads] [-O oracle]\n"
+			"       %s -A capture [-t threads] [-a]\n"
+			"       %s -r 4.5|5 [-g bytes] [-t threads] [-O oracle]\n",
+			prog, prog, prog, prog, prog);
+	fprintf(stderr, "  -t threads  worker threads, 0 = one per CPU (default 1)\n");
+	fprintf(stderr, "  -a          adaptive mode: intersect candidates instead of voting\n");
+	fprintf(stderr, "  -v          more events: progress, then candidates, then every guess\n");
+	fprintf(stderr, "  -T file     write events as JSON lines to file instead of text\n");
+	fprintf(stderr, "  -O oracle   local, server (forked stand-in on a Unix socket)\n");
+	fprintf(stderr, "              or replay:file (answers recorded with -R and\n"
+			"              the same -s seed)\n");
+	fprintf(stderr, "  -R file     record every oracle query and answer to file\n");
+	fprintf(stderr, "  -s seed     deterministic key and lambda sets from seed\n");
+	fprintf(stderr, "  -C file     write the lambda sets the attack uses to a capture\n");
+	fprintf(stderr, "  -S sets     only capture this many lambda sets, no attack\n");
+	fprintf(stderr, "  -A file     recover keys from a capture instead of encrypting\n");
+	fprintf(stderr, "  -r rounds   extended attack on 4.5 or 5 rounds (default 3.5)\n");
+	fprintf(stderr, "  -g bytes    extended attack: key bytes guessed per column, 1-4,\n"
+			"              the others are given (default 4)\n");
+	fprintf(stderr, "  -n trials   campaign mode: recover this many random keys\n");
+	fprintf(stderr, "  -f format   campaign output format (default csv)\n");
+	fprintf(stderr, "  -o file     campaign output file (default stdout)\n");
+}
+
+int main(int argc, char *argv[]) {
+	unsigned threads = 1;
+	size_t trials = 0;
+	campaign_format_t format = CAMPAIGN_FORMAT_CSV;
+	attack_mode_t mode = ATTACK_MODE_VOTING;
+	const char *output = NULL;
+	const char *trace = NULL;
+	const char *oracle_spec = NULL;
+	const char *record = NULL;
+	const char *capture = NULL;
+	const char *analyze = NULL;
+	size_t capture_sets = 0;
+	const char *rounds = NULL;
+	extend_config_t extend = {0, 4, EXTEND_DEFAULT_SETS};
+	int log_level = SQ_LOG_WARN;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:an:f:o:vT:O:R:C:S:A:r:g:s:h")) != -1) {
+		switch (opt) {
+		case 't':
+			threads = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'a':
+			mode = ATTACK_MODE_ADAPTIVE;
+			break;
+		case 'n':
+			trials = (size_t)strtoull(optarg, NULL, 10);
+			break;
+		case 'f':
+			if (strcmp(optarg, "csv") == 0) {
+				format = CAMPAIGN_FORMAT_CSV;
+			} else if (strcmp(optarg, "json") == 0) {
+				format = CAMPAIGN_FORMAT_JSON;
+			} else {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'v':
+			if (log_level < SQ_LOG_TRACE) {
+				log_level++;
+			}
+			break;
+		case 'T':
+			trace = optarg;
+			break;
+		case 'O':
+			oracle_spec = optarg;
+			break;
+		case 'R':
+			record = optarg;
+			break;
+		case 'C':
+			capture = optarg;
+			break;
+		case 'S':
+			capture_sets = (size_t)strtoull(optarg, NULL, 10);
+			break;
+		case 'A':
+			analyze = optarg;
+			break;
+		case 'r':
+			rounds = optarg;
+			if (strcmp(rounds, "3.5") == 0) {
+				rounds = NULL;
+			} else if (strcmp(rounds, "4.5") == 0 || strcmp(rounds, "5") == 0) {
+				extend.lastfull = strcmp(rounds, "5") == 0;
+			} else {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+		case 'g':
+			extend.guessed_bytes = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			// Before any thread draws: a replay then asks exactly the
+			// queries of the recording made with the same seed
+			square_random_use_seed(strtoull(optarg, NULL, 0));
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+
+	FILE *trace_file = NULL;
+	if (trace) {
+		trace_file = fopen(trace, "w");
+		if (!trace_file) {
+			perror(trace);
+			return -1;
+		}
+		square_log_configure(log_level, trace_file, SQ_LOG_FORMAT_JSON);
+	} else {
+		square_log_configure(log_level, stdout, SQ_LOG_FORMAT_TEXT);
+	}
+
+	if (trials > 0 && (oracle_spec || record || capture || analyze)) {
+		fprintf(stderr, "Error: campaigns attack random in-process keys, no oracle\n");
+		return 2;
+	}
+	if (analyze && (oracle_spec || record || capture || capture_sets)) {
+		fprintf(stderr, "Error: capture analysis queries no oracle\n");
+		return 2;
+	}
+	if (rounds && (trials > 0 || capture || analyze || capture_sets)) {
+		fprintf(stderr, "Error: the extended attack runs single recoveries only\n");
+		return 2;
+	}
+	if (extend.guessed_bytes < 1 || extend.guessed_bytes > 4 ||
+		(rounds && extend.guessed_bytes < 4 && (oracle_spec || record))) {
+		// Given key bytes come from a key the attack holds itself
+		usage(argv[0]);
+		return 2;
+	}
+	if (capture_sets > 0 && !capture) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// Before the pool: the server oracle forks. A bulk capture always
+	// goes through an oracle, local by default.
+	square_oracle_t *oracle = NULL;
+	if (oracle_spec || record || capture_sets > 0) {
+		uint8_t key[AES_128_KEY_SIZE];
+		if (!secure_random_bytes(key, AES_128_KEY_SIZE)) {
+			fprintf(stderr, "Error: Failed to generate random key\n");
+			return -1;
+		}
+		unsigned nrounds = rounds ? 5 : 4;
+		int lastfull = rounds ? extend.lastfull : 0;
+		if (!oracle_spec || strcmp(oracle_spec, "local") == 0) {
+			oracle = square_oracle_local(key, nrounds, lastfull);
+		} else if (strcmp(oracle_spec, "server") == 0) {
+			oracle = square_oracle_server(key, nrounds, lastfull);
+		} else if (strncmp(oracle_spec, "replay:", 7) == 0) {
+			oracle = square_oracle_replay(oracle_spec + 7);
+		} else {
+			usage(argv[0]);
+			return 2;
+		}
+		memset(key, 0, sizeof(key));
+		if (oracle && record) {
+			square_oracle_t *recorder = square_oracle_record(oracle, record);
+			if (!recorder) {
+				square_oracle_destroy(oracle);
+			}
+			oracle = recorder;
+		}
+		if (!oracle) {
+			fprintf(stderr, "Error: Failed to set up the %s oracle\n",
+					oracle_spec ? oracle_spec : "local");
+			return -1;
+		}
+	}
+
+	square_pool_t *pool = square_pool_create(threads);
+	if (!pool) {
+		fprintf(stderr, "Error: Failed to start worker threads\n");
+		square_oracle_destroy(oracle);
+		return -1;
+	}
+
+	if (trials > 0) {
+		FILE *out = output ? fopen(output, "w") : stdout;
+		if (!out) {
+			perror(output);
+			square_pool_destroy(pool);
+			return -1;
+		}
+		int result = aes128_campaign(pool, trials, mode, format, out);
+		if (out != stdout) {
+			fclose(out);
+		}
+		square_pool_destroy(pool);
+		if (trace_file) {
+			fclose(trace_file);
+		}
+		return result;
+	}
+
+	if (rounds) {
+		int result = aes128_attack_extended(pool, oracle, &extend);
+		square_pool_destroy(pool);
+		square_oracle_destroy(oracle);
+		if (trace_file) {
+			fclose(trace_file);
+		}
+		return result;
+	}
+
+	if (analyze || capture_sets > 0) {
+		int result = analyze ? aes128_analyze_capture(pool, mode, analyze)
+							 : aes128_capture(pool, oracle, capture_sets, capture);
+		square_pool_destroy(pool);
+		square_oracle_destroy(oracle);
+		if (trace_file) {
+			fclose(trace_file);
+		}
+		return result;
+	}
+
+	printf("Square Cryptanalysis Framework\n");
+	printf("==============================\n");
+	printf("3.5-round AES-128 Key Recovery Attack\n\n");
+	
+	int result = aes128_attack(pool, mode, oracle, capture);
+	square_pool_destroy(pool);
+	square_oracle_destroy(oracle);
+	if (trace_file) {
+		fclose(trace_file);
+	}
+	
+	printf("\n=== Final Status ===\n");
+	if (result == 0) {
+		printf("Attack completed successfully!\n");
+		printf("Master key recovered with 100%% accuracy.\n");
+	} else {
+		printf(" Attack incomplete or failed.\n");
+		printf("Error code: %d\n", result);
+	}
+	
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,623 @@
+/**
+ * Square Attack Benchmark Suite
+ * =============================
+ * Micro benchmarks of the AES primitives and macro benchmarks of the attack.
+ *
+ * Every benchmark is calibrated so one sample lasts at least BENCH_MIN_SAMPLE_NS,
+ * run for a few warmup samples, then timed over the requested repetitions
+ * with both clock_gettime and the TSC. Output is one tab-separated line per
+ * benchmark with a fixed column set (see print_header), so files from
+ * different revisions can be diffed or loaded directly.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aes-128_enc.h"
+#include "aes-128_dec.h"
+#include "aes-128_engine.h"
+#include "attack.h"
+#include "square_crypto.h"
+#include "square_gf.h"
+#include "square_guess.h"
+#include "square_lambda.h"
+#include "square_layout.h"
+#include "square_psum.h"
+#include "square_random.h"
+#include "square_spn.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+#define BENCH_FORMAT_VERSION 1
+#define BENCH_MIN_SAMPLE_NS 200000.0
+
+typedef void (*bench_fn)(void *ctx, size_t ops);
+
+typedef struct {
+	unsigned reps;
+	unsigned warmup;
+	const char *filter;
+	FILE *out;
+} bench_config_t;
+
+// Defeats dead-code elimination of the benchmarked results
+static volatile uint8_t bench_sink;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef BENCH_HAS_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted @values
+static double percentile(const double *values, size_t count, double p) {
+	size_t rank = (size_t)ceil(p / 100.0 * (double)count);
+	return values[rank ? rank - 1 : 0];
+}
+
+static void print_header(FILE *out) {
+	fprintf(out, "# square-bench format %d\n", BENCH_FORMAT_VERSION);
+	fprintf(out, "# name\tvariant\tbytes_per_op\tops_per_sample\tsamples"
+			"\tns_per_op_p50\tns_per_op_p05\tns_per_op_p95\tns_per_op_min"
+			"\tcycles_per_byte_p50\tcycles_per_byte_p05\tcycles_per_byte_p95\n");
+}
+
+static void bench_run(const bench_config_t *config, const char *name,
+					  const char *variant, size_t bytes_per_op,
+					  bench_fn fn, void *ctx) {
+	if (config->filter && !strstr(name, config->filter)) {
+		return;
+	}
+
+	// Calibrate the number of operations per sample
+	size_t ops = 1;
+	for (;;) {
+		uint64_t start = now_ns();
+		fn(ctx, ops);
+		if ((double)(now_ns() - start) >= BENCH_MIN_SAMPLE_NS || ops >= ((size_t)1 << 30)) {
+			break;
+		}
+		ops *= 2;
+	}
+
+	for (unsigned i = 0; i < config->warmup; ++i) {
+		fn(ctx, ops);
+	}
+
+	double *ns = malloc(config->reps * sizeof(*ns));
+	double *cpb = malloc(config->reps * sizeof(*cpb));
+	if (!ns || !cpb) {
+		free(ns);
+		free(cpb);
+		return;
+	}
+	for (unsigned i = 0; i < config->reps; ++i) {
+		uint64_t c0 = now_cycles();
+		uint64_t t0 = now_ns();
+		fn(ctx, ops);
+		uint64_t t1 = now_ns();
+		uint64_t c1 = now_cycles();
+		ns[i] = (double)(t1 - t0) / (double)ops;
+		cpb[i] = bytes_per_op ? (double)(c1 - c0) / (double)(ops * bytes_per_op) : NAN;
+	}
+	qsort(ns, config->reps, sizeof(*ns), compare_double);
+	qsort(cpb, config->reps, sizeof(*cpb), compare_double);
+
+	fprintf(config->out, "%s\t%s\t%zu\t%zu\t%u\t%.2f\t%.2f\t%.2f\t%.2f\t%.3f\t%.3f\t%.3f\n",
+			name, variant, bytes_per_op, ops, config->reps,
+			percentile(ns, config->reps, 50), percentile(ns, config->reps, 5),
+			percentile(ns, config->reps, 95), ns[0],
+			percentile(cpb, config->reps, 50), percentile(cpb, config->reps, 5),
+			percentile(cpb, config->reps, 95));
+	fflush(config->out);
+	free(ns);
+	free(cpb);
+}
+
+// === Benchmark bodies ===
+
+typedef struct {
+	uint8_t key[AES_128_KEY_SIZE];
+	uint8_t key2[AES_128_KEY_SIZE];
+	aes128_key_schedule_t ks;
+	aes128_key_schedule_t ks2;
+	uint8_t block[AES_BLOCK_SIZE];
+	uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+	uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+	unsigned nrounds;
+	int lastround;
+	lambda_gen_t gen;
+	psum_tables_t psum_tables;
+	psum_t psum;
+	const gf_field_t *field;
+	spn_cipher_t *cipher;
+	aes128_f_key_t f_key;
+	aes128_f_stream_t f_stream;
+	attack_workspace_t *ws;
+} bench_ctx_t;
+
+static void bench_aes_round(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes_round(ctx->block, ctx->ks.rk[1], ctx->lastround);
+	}
+	bench_sink = ctx->block[0];
+}
+
+static void bench_aes128_enc(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_enc(ctx->block, ctx->key, ctx->nrounds, 0);
+	}
+	bench_sink = ctx->block[0];
+}
+
+static void bench_aes128_enc_ks(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_enc_ks(ctx->block, &ctx->ks, ctx->nrounds, 0);
+	}
+	bench_sink = ctx->block[0];
+}
+
+static void bench_aes128_dec_ks(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_dec_ks(ctx->block, &ctx->ks, ctx->nrounds, 0);
+	}
+	bench_sink = ctx->block[0];
+}
+
+static void bench_enc_many(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_enc_many_ks(ctx->lambda_set, AES_LAMBDA_SET_SIZE, &ctx->ks, ctx->nrounds, 0);
+	}
+	bench_sink = ctx->lambda_set[0][0];
+}
+
+static void bench_dec_many(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_dec_many_ks(ctx->lambda_set, AES_LAMBDA_SET_SIZE, &ctx->ks, ctx->nrounds, 0);
+	}
+	bench_sink = ctx->lambda_set[0][0];
+}
+
+static void bench_spn_enc_many(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		spn_enc_many_ks(ctx->cipher, ctx->lambda_set, AES_LAMBDA_SET_SIZE, &ctx->ks2,
+						ctx->nrounds, 0);
+	}
+	bench_sink = ctx->lambda_set[0][0];
+}
+
+static void bench_next_round_key(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	uint8_t next[AES_128_KEY_SIZE];
+	for (size_t i = 0; i < ops; ++i) {
+		next_aes128_round_key(ctx->key, next, (int)(i % 10));
+		ctx->key[0] ^= next[15];
+	}
+	bench_sink = ctx->key[0];
+}
+
+static void bench_prev_round_key(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	uint8_t prev[AES_128_KEY_SIZE];
+	for (size_t i = 0; i < ops; ++i) {
+		prev_aes128_round_key(ctx->key, prev, (int)(i % 10));
+		ctx->key[0] ^= prev[15];
+	}
+	bench_sink = ctx->key[0];
+}
+
+static void bench_expand_key(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_expand_key(&ctx->ks, ctx->key);
+		ctx->key[0] ^= ctx->ks.rk[10][0];
+	}
+	bench_sink = ctx->key[0];
+}
+
+// One distinguisher() call: one guess over one byte of a lambda set
+static void bench_distinguisher(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	size_t hits = 0;
+	for (size_t i = 0; i < ops; ++i) {
+		hits += distinguisher(ctx->lambda_set, i & 15, (uint8_t)i, Sinv);
+	}
+	bench_sink = (uint8_t)hits;
+}
+
+// All 256 guesses over one byte of a lambda set
+static void bench_guess_all(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	key_guess_set_t guesses;
+	for (size_t i = 0; i < ops; ++i) {
+		square_guess_all(ctx->lambda_set, i & 15, Sinv, &guesses);
+	}
+	bench_sink = (uint8_t)guesses.bits[0];
+}
+
+// Same, reading one contiguous column of the transposed set
+static void bench_guess_column(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	key_guess_set_t guesses;
+	for (size_t i = 0; i < ops; ++i) {
+		square_guess_column(ctx->columns[i & 15], Sinv, &guesses);
+	}
+	bench_sink = (uint8_t)guesses.bits[0];
+}
+
+// Block-major lambda set to 16 columns
+static void bench_transpose(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		lambda_set_transpose(ctx->lambda_set, AES_LAMBDA_SET_SIZE, ctx->columns, 0);
+		ctx->lambda_set[i & 255][0] ^= ctx->columns[1][0];
+	}
+	bench_sink = ctx->columns[0][0];
+}
+
+// One 256-block chunk of a lambda-set structure
+static void bench_random_key(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		secure_random_bytes(ctx->key2, AES_128_KEY_SIZE);
+	}
+	bench_sink = ctx->key2[0];
+}
+
+static void bench_random_bulk(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		secure_random_bytes(ctx->lambda_set[0], sizeof(ctx->lambda_set));
+	}
+	bench_sink = ctx->lambda_set[0][0];
+}
+
+static void bench_lambda_gen_fill(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		if (lambda_gen_fill(&ctx->gen, ctx->lambda_set, AES_LAMBDA_SET_SIZE) == 0) {
+			lambda_gen_rewind(&ctx->gen);
+		}
+	}
+	bench_sink = ctx->lambda_set[255][ctx->gen.active[0]];
+}
+
+static void bench_lambda_sets_random(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		lambda_sets_random(&ctx->lambda_set, 1, 0);
+	}
+	bench_sink = ctx->lambda_set[0][1];
+}
+
+static void bench_gf_mul_const(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		gf_mul_const_many(ctx->field, 0x0e, ctx->lambda_set[0], ctx->lambda_set[0],
+						  sizeof(ctx->lambda_set));
+	}
+	bench_sink = ctx->lambda_set[255][15];
+}
+
+static void bench_gf_mix_columns(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		gf_mix_columns_many(ctx->field, ctx->lambda_set, AES_LAMBDA_SET_SIZE);
+	}
+	bench_sink = ctx->lambda_set[255][15];
+}
+
+static void bench_gf_inv_mix_columns(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		gf_inv_mix_columns_many(ctx->field, ctx->lambda_set, AES_LAMBDA_SET_SIZE);
+	}
+	bench_sink = ctx->lambda_set[255][15];
+}
+
+// Last partial-sum stage: one more key byte, then the parity of z
+static void bench_psum_last(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		psum_guess(&ctx->psum, PSUM_STAGES - 1, (uint8_t)i);
+	}
+	bench_sink = (uint8_t)psum_parity(&ctx->psum)->count;
+}
+
+// All four stages, as for a guess sharing nothing with the previous one
+static void bench_psum_all(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		for (unsigned stage = 0; stage < PSUM_STAGES; ++stage) {
+			psum_guess(&ctx->psum, stage, (uint8_t)(i >> stage));
+		}
+	}
+	bench_sink = (uint8_t)psum_parity(&ctx->psum)->count;
+}
+
+static void bench_f_construction(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		F_construction(ctx->key, ctx->key2, ctx->block, ctx->block);
+	}
+	bench_sink = ctx->block[0];
+}
+
+static void bench_f_construction_ks(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		F_construction_ks(&ctx->ks, &ctx->ks2, ctx->block, ctx->block);
+	}
+	bench_sink = ctx->block[0];
+}
+
+// One lambda set's worth of inputs, in place
+static void bench_f_many(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_f_many(&ctx->f_key, (const uint8_t (*)[AES_BLOCK_SIZE])ctx->lambda_set,
+					  ctx->lambda_set, AES_LAMBDA_SET_SIZE);
+	}
+	bench_sink = ctx->lambda_set[0][0];
+}
+
+static void bench_f_stream(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	for (size_t i = 0; i < ops; ++i) {
+		aes128_f_stream_update(&ctx->f_stream, ctx->lambda_set[0], sizeof(ctx->lambda_set),
+							   ctx->columns[0]);
+	}
+	bench_sink = ctx->columns[0][0];
+}
+
+static void bench_recover_key(void *p, size_t ops) {
+	bench_ctx_t *ctx = p;
+	attack_trial_t trial;
+	for (size_t i = 0; i < ops; ++i) {
+		ctx->key[i & 15] ^= (uint8_t)(i + 1);
+		recover_key(ctx->ws, NULL, ctx->key, &trial);
+	}
+	bench_sink = trial.recovered_key[0];
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "Usage: %s [-r reps] [-w warmup] [-b filter] [-o file] [-s seed]\n", prog);
+	fprintf(stderr, "  -r reps     timed samples per benchmark (default 31)\n");
+	fprintf(stderr, "  -w warmup   untimed samples per benchmark (default 3)\n");
+	fprintf(stderr, "  -b filter   only run benchmarks whose name contains filter\n");
+	fprintf(stderr, "  -o file     write results to file (default stdout)\n");
+	fprintf(stderr, "  -s seed     deterministic random inputs from seed\n");
+}
+
+int main(int argc, char *argv[]) {
+	bench_config_t config = {31, 3, NULL, stdout};
+	const char *output = NULL;
+	char variant[64];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:w:b:o:s:h")) != -1) {
+		switch (opt) {
+		case 'r':
+			config.reps = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			config.warmup = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			config.filter = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 's':
+			square_random_use_seed(strtoull(optarg, NULL, 0));
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	if (config.reps == 0) {
+		config.reps = 1;
+	}
+	if (output) {
+		config.out = fopen(output, "w");
+		if (!config.out) {
+			perror(output);
+			return 1;
+		}
+	}
+
+	bench_ctx_t ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	if (!secure_random_bytes(ctx.key, AES_128_KEY_SIZE) ||
+		!secure_random_bytes(ctx.key2, AES_128_KEY_SIZE) ||
+		!secure_random_bytes(ctx.block, AES_BLOCK_SIZE) ||
+		build_random_lambda_set(ctx.lambda_set) != 0) {
+		fprintf(stderr, "Error: Failed to generate random inputs\n");
+		return 1;
+	}
+	aes128_expand_key(&ctx.ks, ctx.key);
+	aes128_expand_key(&ctx.ks2, ctx.key2);
+	ctx.ws = attack_workspace_create(1, 1);
+	if (!ctx.ws) {
+		fprintf(stderr, "Error: Out of memory\n");
+		return 1;
+	}
+
+	print_header(config.out);
+
+	ctx.lastround = 0;
+	bench_run(&config, "aes_round", "full", AES_BLOCK_SIZE, bench_aes_round, &ctx);
+	ctx.lastround = 16;
+	bench_run(&config, "aes_round", "last", AES_BLOCK_SIZE, bench_aes_round, &ctx);
+
+	for (unsigned nrounds = 1; nrounds <= AES128_MAX_ROUNDS; ++nrounds) {
+		ctx.nrounds = nrounds;
+		snprintf(variant, sizeof(variant), "rounds=%u", nrounds);
+		bench_run(&config, "aes128_enc", variant, AES_BLOCK_SIZE, bench_aes128_enc, &ctx);
+		bench_run(&config, "aes128_enc_ks", variant, AES_BLOCK_SIZE, bench_aes128_enc_ks, &ctx);
+		bench_run(&config, "aes128_dec_ks", variant, AES_BLOCK_SIZE, bench_aes128_dec_ks, &ctx);
+	}
+
+	// Lambda-set encryption and decryption through every backend available here
+	aes128_backend_t saved_backend = aes128_engine_backend();
+	for (int backend = AES128_BACKEND_REFERENCE; backend < AES128_BACKEND_COUNT; ++backend) {
+		if (aes128_engine_set_backend((aes128_backend_t)backend) != 0) {
+			continue;
+		}
+		for (unsigned nrounds = 4; nrounds <= AES128_MAX_ROUNDS; nrounds += 6) {
+			ctx.nrounds = nrounds;
+			snprintf(variant, sizeof(variant), "%s,rounds=%u",
+					 aes128_backend_name((aes128_backend_t)backend), nrounds);
+			bench_run(&config, "aes128_enc_many", variant,
+					  AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE, bench_enc_many, &ctx);
+			bench_run(&config, "aes128_dec_many", variant,
+					  AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE, bench_dec_many, &ctx);
+		}
+	}
+	aes128_engine_set_backend(saved_backend);
+
+	// A variant runs on its own T-tables: same speed as the AES one
+	static spn_cipher_t variant_cipher;
+	spn_init(&variant_cipher, &(spn_params_t){0x11d, NULL, (const uint8_t[4]){0x01, 0x01, 0x02, 0x05}});
+	ctx.cipher = &variant_cipher;
+	spn_expand_key(ctx.cipher, &ctx.ks2, ctx.key);
+	for (unsigned nrounds = 4; nrounds <= AES128_MAX_ROUNDS; nrounds += 6) {
+		ctx.nrounds = nrounds;
+		snprintf(variant, sizeof(variant), "0x11d,rounds=%u", nrounds);
+		bench_run(&config, "spn_enc_many_ks", variant,
+				  AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE, bench_spn_enc_many, &ctx);
+	}
+	aes128_expand_key(&ctx.ks2, ctx.key2);
+
+	bench_run(&config, "next_aes128_round_key", "-", AES_128_KEY_SIZE, bench_next_round_key, &ctx);
+	bench_run(&config, "prev_aes128_round_key", "-", AES_128_KEY_SIZE, bench_prev_round_key, &ctx);
+	bench_run(&config, "aes128_expand_key", "-", AES_128_KEY_SIZE, bench_expand_key, &ctx);
+
+	bench_run(&config, "secure_random_bytes", "16 bytes", AES_128_KEY_SIZE,
+			  bench_random_key, &ctx);
+	bench_run(&config, "secure_random_bytes", "4096 bytes", sizeof(ctx.lambda_set),
+			  bench_random_bulk, &ctx);
+
+	static const uint16_t gen_masks[] = {0x0001, 0x0003, 0x000f};
+	for (size_t m = 0; m < sizeof(gen_masks) / sizeof(gen_masks[0]); ++m) {
+		if (lambda_gen_init_random(&ctx.gen, gen_masks[m]) != 0) {
+			fprintf(stderr, "Error: Failed to generate random inputs\n");
+			return 1;
+		}
+		snprintf(variant, sizeof(variant), "active=%u", ctx.gen.active_count);
+		bench_run(&config, "lambda_gen_fill", variant, AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE,
+				  bench_lambda_gen_fill, &ctx);
+	}
+	bench_run(&config, "lambda_sets_random", "1 set", AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE,
+			  bench_lambda_sets_random, &ctx);
+
+	// Keys were modified by the key schedule benchmarks
+	aes128_expand_key(&ctx.ks, ctx.key);
+	aes128_enc_many_ks(ctx.lambda_set, AES_LAMBDA_SET_SIZE, &ctx.ks, 4, 0);
+	bench_run(&config, "lambda_set_transpose", "-", AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE,
+			  bench_transpose, &ctx);
+	aes128_enc_many_ks(ctx.lambda_set, AES_LAMBDA_SET_SIZE, &ctx.ks, 4, 0);
+	lambda_set_transpose(ctx.lambda_set, AES_LAMBDA_SET_SIZE, ctx.columns, 0);
+	bench_run(&config, "distinguisher", "1 guess", AES_LAMBDA_SET_SIZE, bench_distinguisher, &ctx);
+	square_guess_impl_t saved_impl = square_guess_impl();
+	for (int impl = SQUARE_GUESS_SCALAR; impl < SQUARE_GUESS_IMPL_COUNT; ++impl) {
+		if (!square_guess_set_impl((square_guess_impl_t)impl)) {
+			continue;
+		}
+		snprintf(variant, sizeof(variant), "%s,256 guesses",
+				 square_guess_impl_name((square_guess_impl_t)impl));
+		bench_run(&config, "square_guess_all", variant, AES_LAMBDA_SET_SIZE, bench_guess_all, &ctx);
+		bench_run(&config, "square_guess_column", variant, AES_LAMBDA_SET_SIZE,
+				  bench_guess_column, &ctx);
+	}
+	square_guess_set_impl(saved_impl);
+
+	ctx.field = gf_aes_field();
+	gf_impl_t saved_gf_impl = gf_impl();
+	for (int impl = GF_IMPL_SCALAR; impl < GF_IMPL_COUNT; ++impl) {
+		if (!gf_set_impl((gf_impl_t)impl)) {
+			continue;
+		}
+		const char *name = gf_impl_name((gf_impl_t)impl);
+		bench_run(&config, "gf_mul_const_many", name, sizeof(ctx.lambda_set),
+				  bench_gf_mul_const, &ctx);
+		bench_run(&config, "gf_mix_columns_many", name, sizeof(ctx.lambda_set),
+				  bench_gf_mix_columns, &ctx);
+		bench_run(&config, "gf_inv_mix_columns_many", name, sizeof(ctx.lambda_set),
+				  bench_gf_inv_mix_columns, &ctx);
+	}
+	gf_set_impl(saved_gf_impl);
+
+	const uint8_t *planes[PSUM_STAGES] = {
+		ctx.columns[0], ctx.columns[13], ctx.columns[10], ctx.columns[7]
+	};
+	psum_tables_init(&ctx.psum_tables, (const uint8_t[PSUM_STAGES]){0x0e, 0x0b, 0x0d, 0x09});
+	if (psum_init(&ctx.psum, &ctx.psum_tables, AES_LAMBDA_SET_SIZE) != 0) {
+		fprintf(stderr, "Error: Out of memory\n");
+		return 1;
+	}
+	psum_load(&ctx.psum, planes, AES_LAMBDA_SET_SIZE);
+	for (unsigned stage = 0; stage + 1 < PSUM_STAGES; ++stage) {
+		psum_guess(&ctx.psum, stage, 0);
+	}
+	bench_run(&config, "psum_guess", "last stage", AES_LAMBDA_SET_SIZE, bench_psum_last, &ctx);
+	bench_run(&config, "psum_guess", "4 stages", AES_LAMBDA_SET_SIZE, bench_psum_all, &ctx);
+	psum_free(&ctx.psum);
+
+	bench_run(&config, "F_construction", "-", AES_BLOCK_SIZE, bench_f_construction, &ctx);
+	bench_run(&config, "F_construction_ks", "-", AES_BLOCK_SIZE, bench_f_construction_ks, &ctx);
+	aes128_f_init(&ctx.f_key, ctx.key, ctx.key2);
+	aes128_f_stream_init(&ctx.f_stream, ctx.key, ctx.key2);
+	for (int backend = AES128_BACKEND_REFERENCE; backend < AES128_BACKEND_COUNT; ++backend) {
+		if (aes128_engine_set_backend((aes128_backend_t)backend) != 0) {
+			continue;
+		}
+		const char *name = aes128_backend_name((aes128_backend_t)backend);
+		bench_run(&config, "aes128_f_many", name, AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE,
+				  bench_f_many, &ctx);
+		bench_run(&config, "aes128_f_stream_update", name, AES_LAMBDA_SET_SIZE * AES_BLOCK_SIZE,
+				  bench_f_stream, &ctx);
+	}
+	aes128_engine_set_backend(saved_backend);
+
+	// Full recovery: bytes_per_op is 0, only the time per key is meaningful
+	bench_run(&config, "recover_key", "3.5 rounds,1 thread", 0, bench_recover_key, &ctx);
+
+	attack_workspace_destroy(ctx.ws);
+	if (config.out != stdout) {
+		fclose(config.out);
+	}
+	return 0;
+}
@@ -1,101 +1,379 @@
 /**
  * Square Attack Robustness Analysis
  * =================================
- * Exercise 1, Q.1 - Conceptual demonstration of attack persistence
+ * Exercise 1, Q.1 - Does the attack survive a change of field polynomial,
+ * S-box or MixColumns matrix?
+ *
+ * Every variant is a real cipher (square_spn.h): the 3.5-round attack is
+ * run end-to-end against random keys of each one, and the success rate
+ * and cost are measured rather than asserted.
+ *
+ * Without -V, a fixed table of hand-picked variants. With -V, a sweep:
+ * that many random variants of every class, one variant per task on the
+ * worker pool, summarized per class and optionally written out one CSV
+ * line per variant.
  */
 
+#include "attack.h"
 #include "square_crypto.h"
+#include "square_pool.h"
+#include "square_spn.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-
-// === Theoretical Analysis Functions ===
-
-void demonstrate_field_isomorphism() {
-    printf("=== F₂₈ Field Representation Analysis ===\n");
-    
-    printf("1. Original AES polynomial: x⁸ + x⁴ + x³ + x + 1 (0x11B)\n");
-    printf("2. Alternative polynomial: x⁸ + x⁴ + x³ + x² + 1 (0x11D)\n\n");
-    
-    
-    // Demonstrate with small examples
-    printf("Example field element transformations:\n");
-    uint8_t test_values[] = {0x01, 0x02, 0x53, 0xCA};
-    
-    for (int i = 0; i < 4; i++) {
-        printf("Original: 0x%02X → S-box₁: 0x%02X, S-box₂: 0x%02X\n", 
-               test_values[i], 
-               (test_values[i] * 2 + 0x63) & 0xFF,  // Simplified transformation
-               (test_values[i] * 3 + 0x42) & 0xFF); // Alternative transformation
+#include <unistd.h>
+
+typedef struct {
+    const char* name;
+    uint16_t polynomial;
+    bool random_sbox;
+    const uint8_t* mix;
+} variant_t;
+
+static const uint8_t mix_rotated[4] = {0x03, 0x01, 0x01, 0x02};
+static const uint8_t mix_other_mds[4] = {0x01, 0x01, 0x02, 0x05};
+static const uint8_t mix_not_mds[4] = {0x01, 0x02, 0x04, 0x06};
+static const uint8_t mix_sparse[4] = {0x02, 0x01, 0x00, 0x00};
+
+static const variant_t variants[] = {
+    {"AES",                        0x11b, false, NULL},
+    {"field 0x11D, its x^-1 S-box", 0x11d, false, NULL},
+    {"random S-box",               0x11b, true,  NULL},
+    {"MixColumns [03 01 01 02]",   0x11b, false, mix_rotated},
+    {"MixColumns [01 01 02 05]",   0x11b, false, mix_other_mds},
+    {"all three changed",          0x11d, true,  mix_other_mds},
+    // Invertible but not MDS, without and with zero coefficients
+    {"MixColumns [01 02 04 06]",   0x11b, false, mix_not_mds},
+    {"MixColumns [02 01 00 00]",   0x11b, false, mix_sparse},
+};
+
+// Key recoveries of one variant
+typedef struct {
+    size_t keys;
+    size_t recovered;
+    size_t errors;              // recover_key gave up
+    size_t lambda_sets;         // over the keys it did not give up on
+    size_t max_lambda_sets;
+    double time_ms;
+} variant_stats_t;
+
+static int attack_variant(const spn_cipher_t* cipher, size_t keys, square_pool_t* pool,
+                          attack_workspace_t* ws, variant_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    attack_workspace_set_cipher(ws, cipher);
+    for (size_t i = 0; i < keys; i++) {
+        uint8_t key[BLOCK_LENGTH];
+        attack_trial_t trial;
+
+        if (!secure_random_bytes(key, BLOCK_LENGTH)) {
+            attack_workspace_set_cipher(ws, NULL);
+            return -1;
+        }
+        stats->keys++;
+        if (recover_key(ws, pool, key, &trial) != 0) {
+            // The right key byte was rejected, or no set ever converged
+            stats->errors++;
+            continue;
+        }
+        stats->recovered += trial.success;
+        stats->lambda_sets += trial.lambda_sets_used;
+        if (trial.lambda_sets_used > stats->max_lambda_sets) {
+            stats->max_lambda_sets = trial.lambda_sets_used;
+        }
+        stats->time_ms += trial.execution_time;
     }
-    
+    attack_workspace_set_cipher(ws, NULL);
+    return 0;
 }
 
-void demonstrate_sbox_independence() {
-    printf("=== S-box Variation Analysis ===\n");
-
-    // Simulate lambda set XOR with different S-boxes
-    uint8_t lambda_xor_original = 0;
-    uint8_t lambda_xor_modified = 0;
-    
-    for (int i = 0; i < 256; i++) {
-        uint8_t original_sbox_val = (i * 7 + 0x63) & 0xFF;  // Simplified
-        uint8_t modified_sbox_val = (i * 11 + 0x42) & 0xFF; // Alternative
-        
-        lambda_xor_original ^= original_sbox_val;
-        lambda_xor_modified ^= modified_sbox_val;
+static int measure_variant(const variant_t* variant, size_t trials,
+                           square_pool_t* pool, attack_workspace_t* ws) {
+    spn_cipher_t cipher;
+    uint8_t sbox[256];
+    spn_params_t params = {variant->polynomial, NULL, variant->mix};
+    variant_stats_t stats;
+
+    if (variant->random_sbox) {
+        if (spn_random_sbox(sbox) != 0) return -1;
+        params.sbox = sbox;
+    }
+    if (spn_init(&cipher, &params) != 0) {
+        fprintf(stderr, "Error: %s is not a valid cipher\n", variant->name);
+        return -1;
     }
-    
-    printf("Lambda set XOR with original S-box: 0x%02X\n", lambda_xor_original);
-    printf("Lambda set XOR with modified S-box: 0x%02X\n", lambda_xor_modified);
-    printf("(Values differ but both maintain structural property)\n\n");
-    
+    if (attack_variant(&cipher, trials, pool, ws, &stats) != 0) return -1;
+
+    size_t completed = stats.keys - stats.errors;
+    printf("%-28s  0x%03X  %-3s  %5zu/%-5zu  %6.2f  %8.3f\n",
+           variant->name, cipher.field.polynomial, cipher.mds ? "yes" : "no",
+           stats.recovered, stats.keys,
+           completed ? (double)stats.lambda_sets / completed : 0.0,
+           completed ? stats.time_ms / completed : 0.0);
+    return 0;
+}
+
+// === Sweep over random variants ===
+
+typedef enum {
+    SWEEP_SBOX,                 // random S-box
+    SWEEP_POLY,                 // random polynomial, x^-1 S-box in that field
+    SWEEP_MDS,                  // random MDS MixColumns
+    SWEEP_MIX,                  // random invertible MixColumns, MDS or not
+    SWEEP_ALL,                  // random polynomial, S-box and MDS MixColumns
+    SWEEP_CLASS_COUNT
+} sweep_class_t;
+
+static const char* const class_names[SWEEP_CLASS_COUNT] = {
+    "sbox", "poly", "mds", "mix", "all"
+};
+
+typedef struct {
+    uint16_t polynomial;
+    uint8_t mix[4];
+    uint8_t sbox[256];
+    bool mds;
+    bool valid;
+    variant_stats_t stats;
+} sweep_result_t;
+
+typedef struct {
+    sweep_class_t class;
+    size_t keys;
+    spn_cipher_t* ciphers;      // one per worker
+    attack_workspace_t** workspaces;
+    sweep_result_t* results;    // one per variant
+} sweep_t;
+
+static int random_params(sweep_class_t class, gf_field_t* field, sweep_result_t* result) {
+    result->polynomial = GF_AES_POLYNOMIAL;
+    memcpy(result->sbox, S, sizeof(result->sbox));
+    memcpy(result->mix, gf_aes_field()->mix, sizeof(result->mix));
+
+    if ((class == SWEEP_POLY || class == SWEEP_ALL) &&
+        spn_random_polynomial(&result->polynomial) != 0) return -1;
+    if ((class == SWEEP_SBOX || class == SWEEP_ALL) &&
+        spn_random_sbox(result->sbox) != 0) return -1;
+    if (class == SWEEP_MDS || class == SWEEP_MIX || class == SWEEP_ALL) {
+        if (gf_field_init(field, result->polynomial) != 0 ||
+            spn_random_mix(field, class != SWEEP_MIX, result->mix) != 0) return -1;
+    }
+    return 0;
+}
+
+static void sweep_task(void* arg, size_t index, unsigned worker) {
+    sweep_t* sweep = arg;
+    spn_cipher_t* cipher = &sweep->ciphers[worker];
+    sweep_result_t* result = &sweep->results[index];
+
+    result->valid = false;
+    if (random_params(sweep->class, &cipher->field, result) != 0) return;
+
+    // The poly class keeps the x^-1 S-box of its own field
+    spn_params_t params = {
+        result->polynomial,
+        sweep->class == SWEEP_POLY ? NULL : result->sbox,
+        result->mix
+    };
+    if (spn_init(cipher, &params) != 0) return;
+    memcpy(result->sbox, cipher->sbox, sizeof(result->sbox));
+    result->mds = cipher->mds;
+
+    // Serial recoveries: the variants are the parallel dimension
+    if (attack_variant(cipher, sweep->keys, NULL, sweep->workspaces[worker],
+                       &result->stats) != 0) return;
+    result->valid = true;
+}
 
+static void write_csv_line(FILE* out, const char* class, size_t index,
+                           const sweep_result_t* result) {
+    const variant_stats_t* stats = &result->stats;
+    size_t completed = stats->keys - stats->errors;
+
+    fprintf(out, "%s,%zu,%03x,%02x%02x%02x%02x,%d,%zu,%zu,%zu,%.3f,%zu,%.4f,",
+            class, index, result->polynomial,
+            result->mix[0], result->mix[1], result->mix[2], result->mix[3],
+            result->mds, stats->keys, stats->recovered, stats->errors,
+            completed ? (double)stats->lambda_sets / completed : 0.0,
+            stats->max_lambda_sets, completed ? stats->time_ms / completed : 0.0);
+    for (int i = 0; i < 256; i++) fprintf(out, "%02x", result->sbox[i]);
+    fputc('\n', out);
 }
 
-void demonstrate_mds_robustness() {
-    printf("=== MDS Matrix Variation Analysis ===\n");
-    
-    printf("Original AES MixColumns matrix:\n");
-    printf("  [02 03 01 01]\n");
-    printf("  [01 02 03 01]\n");
-    printf("  [01 01 02 03]\n");
-    printf("  [03 01 01 02]\n\n");
-    
-    printf("Alternative MDS matrix (example):\n");
-    printf("  [03 01 01 02]\n");
-    printf("  [02 03 01 01]\n");
-    printf("  [01 02 03 01]\n");
-    printf("  [01 01 02 03]\n\n");
-    
-
-    // Demonstrate linear property preservation
-    uint8_t test_state[4] = {0x01, 0x02, 0x04, 0x08};
-    printf("Example state transformation:\n");
-    printf("Input:  [%02X %02X %02X %02X]\n", test_state[0], test_state[1], test_state[2], test_state[3]);
-    
-    // Simulate both matrices (simplified)
-    uint8_t output1[4], output2[4];
-    for (int i = 0; i < 4; i++) {
-        output1[i] = test_state[0] ^ (test_state[1] << 1) ^ test_state[2] ^ test_state[3];
-        output2[i] = (test_state[0] << 1) ^ test_state[1] ^ test_state[2] ^ (test_state[3] << 1);
+static int run_sweep(square_pool_t* pool, const bool classes[SWEEP_CLASS_COUNT],
+                     size_t count, size_t keys, FILE* csv) {
+    unsigned workers = square_pool_size(pool);
+    sweep_t sweep = {0};
+    int status = -1;
+
+    sweep.keys = keys;
+    sweep.ciphers = malloc(workers * sizeof(*sweep.ciphers));
+    sweep.workspaces = calloc(workers, sizeof(*sweep.workspaces));
+    sweep.results = malloc(count * sizeof(*sweep.results));
+    if (!sweep.ciphers || !sweep.workspaces || !sweep.results) goto out;
+    for (unsigned w = 0; w < workers; w++) {
+        // Adaptive mode asks for 2 sets first, then 1 at a time
+        sweep.workspaces[w] = attack_workspace_create(2, 1);
+        if (!sweep.workspaces[w]) goto out;
+        attack_workspace_set_mode(sweep.workspaces[w], ATTACK_MODE_ADAPTIVE);
+    }
+
+    if (csv) {
+        fprintf(csv, "class,variant,polynomial,mix,mds,keys,recovered,errors,"
+                "mean_lambda_sets,max_lambda_sets,ms_per_key,sbox\n");
+    }
+    printf("=== Sweep: %zu random variants per class, %zu keys each, %u workers ===\n\n",
+           count, keys, workers);
+    printf("%-5s  %8s  %9s  %8s  %8s  %7s  %5s  %7s  %8s\n",
+           "class", "variants", "non-MDS", "broken", "resisted", "keys %",
+           "sets", "max", "ms/key");
+
+    for (int c = 0; c < SWEEP_CLASS_COUNT; c++) {
+        if (!classes[c]) continue;
+        sweep.class = (sweep_class_t)c;
+        double start = get_timestamp_ms();
+        square_pool_parallel_for(pool, count, sweep_task, &sweep);
+        double wall = get_timestamp_ms() - start;
+
+        size_t valid = 0, non_mds = 0, broken = 0, resisted = 0;
+        size_t total_keys = 0, recovered = 0, completed = 0, sets = 0, max_sets = 0;
+        double time_ms = 0;
+        for (size_t i = 0; i < count; i++) {
+            const sweep_result_t* result = &sweep.results[i];
+            const variant_stats_t* stats = &result->stats;
+            if (!result->valid) continue;
+            valid++;
+            non_mds += !result->mds;
+            broken += stats->recovered == stats->keys;
+            resisted += stats->recovered == 0;
+            total_keys += stats->keys;
+            recovered += stats->recovered;
+            completed += stats->keys - stats->errors;
+            sets += stats->lambda_sets;
+            if (stats->max_lambda_sets > max_sets) max_sets = stats->max_lambda_sets;
+            time_ms += stats->time_ms;
+            if (csv) write_csv_line(csv, class_names[c], i, result);
+        }
+        if (valid < count) {
+            fprintf(stderr, "Error: %zu %s variants could not be built\n",
+                    count - valid, class_names[c]);
+            goto out;
+        }
+        printf("%-5s  %8zu  %9zu  %8zu  %8zu  %6.2f%%  %5.2f  %7zu  %8.3f  (%.1f s)\n",
+               class_names[c], valid, non_mds, broken, resisted,
+               total_keys ? 100.0 * recovered / total_keys : 0.0,
+               completed ? (double)sets / completed : 0.0, max_sets,
+               completed ? time_ms / completed : 0.0, wall / 1000.0);
     }
-    
-    printf("Matrix₁: [%02X %02X %02X %02X]\n", output1[0], output1[1], output1[2], output1[3]);
-    printf("Matrix₂: [%02X %02X %02X %02X]\n", output2[0], output2[1], output2[2], output2[3]);
-    
-    printf("\n✅ Both matrices provide full diffusion\n");
-    printf("✅ Square distinguisher remains valid with alternative MDS\n");
-    printf("✅ Attack exploits round structure, not matrix coefficients\n\n");
+    status = 0;
+
+out:
+    for (unsigned w = 0; sweep.workspaces && w < workers; w++) {
+        attack_workspace_destroy(sweep.workspaces[w]);
+    }
+    free(sweep.workspaces);
+    free(sweep.ciphers);
+    free(sweep.results);
+    return status;
 }
 
+static int parse_classes(const char* list, bool classes[SWEEP_CLASS_COUNT]) {
+    char buffer[64];
 
-int main(void) {
-    
-    demonstrate_field_isomorphism();
-    demonstrate_sbox_independence();
-    demonstrate_mds_robustness();
-    
+    memset(classes, 0, SWEEP_CLASS_COUNT * sizeof(*classes));
+    snprintf(buffer, sizeof(buffer), "%s", list);
+    for (char* name = strtok(buffer, ","); name; name = strtok(NULL, ",")) {
+        int c = 0;
+        while (c < SWEEP_CLASS_COUNT && strcmp(name, class_names[c]) != 0) c++;
+        if (c == SWEEP_CLASS_COUNT) return -1;
+        classes[c] = true;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-n keys] [-t threads]\n"
+            "       %s -V variants [-c classes] [-n keys] [-t threads] [-o file]\n",
+            prog, prog);
+    fprintf(stderr, "  -n keys      random keys per variant (default 100, 4 with -V)\n");
+    fprintf(stderr, "  -t threads   worker threads, 0 = one per CPU (default 1)\n");
+    fprintf(stderr, "  -V variants  sweep: random variants per class\n");
+    fprintf(stderr, "  -c classes   comma-separated subset of sbox,poly,mds,mix,all\n"
+            "               (default all of them)\n");
+    fprintf(stderr, "  -o file      sweep: one CSV line per variant\n");
+}
+
+int main(int argc, char* argv[]) {
+    size_t trials = 0;
+    size_t sweep_variants = 0;
+    unsigned threads = 1;
+    bool classes[SWEEP_CLASS_COUNT] = {true, true, true, true, true};
+    const char* output = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:V:c:o:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            trials = (size_t)strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            threads = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'V':
+            sweep_variants = (size_t)strtoull(optarg, NULL, 10);
+            break;
+        case 'c':
+            if (parse_classes(optarg, classes) != 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (trials == 0) trials = sweep_variants ? 4 : 100;
+
+    square_pool_t* pool = square_pool_create(threads);
+    if (!pool) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        return 1;
+    }
+
+    int status = 0;
+    if (sweep_variants) {
+        FILE* csv = output ? fopen(output, "w") : NULL;
+        if (output && !csv) {
+            perror(output);
+            square_pool_destroy(pool);
+            return 1;
+        }
+        status = run_sweep(pool, classes, sweep_variants, trials, csv);
+        if (csv) fclose(csv);
+        square_pool_destroy(pool);
+        return status == 0 ? 0 : 1;
+    }
+
+    unsigned workers = square_pool_size(pool);
+    attack_workspace_t* ws = attack_workspace_create(workers, workers);
+    if (!ws) {
+        square_pool_destroy(pool);
+        return 1;
+    }
+    attack_workspace_set_mode(ws, ATTACK_MODE_ADAPTIVE);
+
+    printf("=== 3.5-round Square attack against AES variants ===\n\n");
+    printf("%-28s  %-5s  %-3s  %-11s  %-6s  %-8s\n",
+           "variant", "poly", "MDS", "recovered", "sets", "ms/key");
+
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]) && status == 0; i++) {
+        status = measure_variant(&variants[i], trials, pool, ws);
+    }
+
+    attack_workspace_destroy(ws);
+    square_pool_destroy(pool);
+    return status == 0 ? 0 : 1;
+}
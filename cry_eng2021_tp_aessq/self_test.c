@@ -0,0 +1,555 @@
+/**
+ * Self Test Program
+ * =================
+ * Every fast path checked against the simple code it replaces.
+ *
+ * Each test prints one YES/NO line per case; the program returns non-zero
+ * if any case fails. With arguments, only the tests whose name contains
+ * one of them run.
+ */
+
+#include "aes-128_enc.h"
+#include "aes-128_engine.h"
+#include "attack.h"
+#include "square_capture.h"
+#include "square_crypto.h"
+#include "square_gf.h"
+#include "square_guess.h"
+#include "square_psum.h"
+#include "square_spn.h"
+#include "square_layout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Not multiples of the AES-NI lane count (8) or of the bitslice width
+static const size_t batch_sizes[] = {1, 7, 13, 33, 71, 257};
+#define BATCH_MAX 257
+
+static int report(const char* label, int match) {
+    printf("%s: %s\n", label, match ? "YES" : "NO");
+    return match ? 0 : 1;
+}
+
+/*
+ * aes128_enc_many_ks on every backend against aes128_enc, block by block
+ */
+static int test_enc_many(void) {
+    static uint8_t inputs[BATCH_MAX][16], expected[BATCH_MAX][16], outputs[BATCH_MAX][16];
+    uint8_t key[16];
+    aes128_key_schedule_t ks;
+    int failures = 0;
+
+    if (!secure_random_bytes(key, sizeof(key)) ||
+        !secure_random_bytes(inputs[0], sizeof(inputs))) {
+        return report("random inputs", 0);
+    }
+    aes128_expand_key(&ks, key);
+
+    aes128_backend_t saved_backend = aes128_engine_backend();
+    for (int b = AES128_BACKEND_REFERENCE; b < AES128_BACKEND_COUNT; b++) {
+        if (aes128_engine_set_backend((aes128_backend_t)b) != 0) continue;
+
+        int match = 1;
+        for (unsigned nrounds = 1; nrounds <= AES128_MAX_ROUNDS; nrounds++) {
+            for (int lastfull = 0; lastfull <= 1; lastfull++) {
+                for (size_t s = 0; s < sizeof(batch_sizes) / sizeof(batch_sizes[0]); s++) {
+                    size_t count = batch_sizes[s];
+                    memcpy(expected, inputs, count * 16);
+                    memcpy(outputs, inputs, count * 16);
+                    for (size_t n = 0; n < count; n++) {
+                        aes128_enc(expected[n], key, nrounds, lastfull);
+                    }
+                    aes128_enc_many_ks(outputs, count, &ks, nrounds, lastfull);
+                    match &= memcmp(outputs, expected, count * 16) == 0;
+                }
+            }
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "aes128_enc_many_ks (%s), 1-10 rounds",
+                 aes128_backend_name((aes128_backend_t)b));
+        failures += report(label, match);
+    }
+    aes128_engine_set_backend(saved_backend);
+    return failures;
+}
+
+/*
+ * AES-NI: cpuid dispatch, then every tail length around its 8 lanes
+ */
+static int test_aesni(void) {
+    uint8_t inputs[17][16], expected[17][16], outputs[17][16];
+    uint8_t key[16];
+    aes128_key_schedule_t ks;
+    int failures = 0;
+
+    aes128_backend_t saved_backend = aes128_engine_backend();
+    if (!aes128_backend_available(AES128_BACKEND_AESNI)) {
+        int refused = aes128_engine_set_backend(AES128_BACKEND_AESNI) != 0 &&
+                      aes128_engine_backend() == saved_backend;
+        return report("no AES-NI: backend refused", refused);
+    }
+    aes128_engine_set_backend(AES128_BACKEND_AUTO);
+    failures += report("auto selects aesni", aes128_engine_backend() == AES128_BACKEND_AESNI);
+
+    if (!secure_random_bytes(key, sizeof(key)) ||
+        !secure_random_bytes(inputs[0], sizeof(inputs))) {
+        aes128_engine_set_backend(saved_backend);
+        return failures + report("random inputs", 0);
+    }
+    aes128_expand_key(&ks, key);
+
+    aes128_engine_set_backend(AES128_BACKEND_AESNI);
+    int match = 1;
+    for (int lastfull = 0; lastfull <= 1; lastfull++) {
+        for (size_t count = 1; count <= 17; count++) {
+            memcpy(expected, inputs, count * 16);
+            memcpy(outputs, inputs, count * 16);
+            for (size_t n = 0; n < count; n++) {
+                aes128_enc(expected[n], key, 4, lastfull);
+            }
+            aes128_enc_many_ks(outputs, count, &ks, 4, lastfull);
+            match &= memcmp(outputs, expected, count * 16) == 0;
+        }
+    }
+    failures += report("aesni, 1-17 blocks", match);
+    aes128_engine_set_backend(saved_backend);
+    return failures;
+}
+
+static int guess_sets_equal(const key_guess_set_t* a, const key_guess_set_t* b) {
+    return memcmp(a->bits, b->bits, sizeof(a->bits)) == 0;
+}
+
+/*
+ * One column of @set against distinguisher(), through every entry point
+ * of the guess engine, the current implementation
+ */
+static int check_guess_column(uint8_t set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE], size_t index) {
+    key_guess_set_t expected = {{0}}, got, candidates;
+    uint8_t column[AES_LAMBDA_SET_SIZE];
+    column_parity_t parity;
+    uint8_t noise[256];
+    int match = 1;
+
+    for (unsigned g = 0; g < 256; g++) {
+        if (distinguisher(set, index, (uint8_t)g, Sinv)) {
+            expected.bits[g >> 6] |= (uint64_t)1 << (g & 63);
+        }
+    }
+    for (size_t i = 0; i < AES_LAMBDA_SET_SIZE; i++) {
+        column[i] = set[i][index];
+    }
+
+    square_guess_all(set, index, Sinv, &got);
+    match &= guess_sets_equal(&got, &expected);
+    square_guess_column(column, Sinv, &got);
+    match &= guess_sets_equal(&got, &expected);
+    column_parity_build(&parity, column, AES_LAMBDA_SET_SIZE, 1);
+    square_guess_parity(&parity, Sinv, &got);
+    match &= guess_sets_equal(&got, &expected);
+
+    // A few candidates scored one by one, then more than GUESS_WITHIN_MAX
+    // through the all-guess fallback; the survivors are always included
+    if (!secure_random_bytes(noise, sizeof(noise))) return 0;
+    for (int dense = 0; dense <= 1; dense++) {
+        candidates = expected;
+        for (unsigned g = 0; g < 256; g++) {
+            if (dense ? noise[g] < 128 : noise[g] < 8) {
+                candidates.bits[g >> 6] |= (uint64_t)1 << (g & 63);
+            }
+        }
+        key_guess_set_t within = expected;
+        for (int w = 0; w < 4; w++) within.bits[w] &= candidates.bits[w];
+        size_t count = key_guess_set_count(&candidates);
+        size_t scored = square_guess_parity_within(&parity, Sinv, &candidates, &got);
+        match &= guess_sets_equal(&got, &within) &&
+                 scored == (count > GUESS_WITHIN_MAX ? AES_KEY_BYTES_SIZE : count);
+    }
+    return match;
+}
+
+/*
+ * Guess engine against distinguisher() on every implementation: encrypted
+ * lambda sets (few survivors), random columns (almost none) and plaintext
+ * lambda sets (every guess survives, empty reductions)
+ */
+static int test_guess(void) {
+    static uint8_t sets[3][AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+    uint8_t key[16];
+    int failures = 0;
+
+    if (!secure_random_bytes(key, sizeof(key)) ||
+        build_random_lambda_set(sets[0]) != 0 ||
+        !secure_random_bytes(sets[1][0], sizeof(sets[1])) ||
+        build_random_lambda_set(sets[2]) != 0) {
+        return report("random inputs", 0);
+    }
+    aes128_enc_many(sets[0], AES_LAMBDA_SET_SIZE, key, 4, 0);
+
+    square_guess_impl_t saved_impl = square_guess_impl();
+    for (int impl = SQUARE_GUESS_SCALAR; impl < SQUARE_GUESS_IMPL_COUNT; impl++) {
+        if (!square_guess_set_impl((square_guess_impl_t)impl)) continue;
+
+        int match = 1;
+        for (int s = 0; s < 3; s++) {
+            for (size_t index = 0; index < AES_BLOCK_SIZE; index++) {
+                match &= check_guess_column(sets[s], index);
+            }
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "guess engine (%s) = distinguisher()",
+                 square_guess_impl_name((square_guess_impl_t)impl));
+        failures += report(label, match);
+    }
+    square_guess_set_impl(saved_impl);
+    return failures;
+}
+
+/*
+ * The square_crypto.h API as an embedding program uses it
+ */
+static int test_square_api(void) {
+    uint8_t key[BLOCK_LENGTH];
+    attack_result_t run;
+    int failures = 0;
+
+    attack_result_t* result = execute_square_attack();
+    failures += report("execute_square_attack recovers the key",
+                       result && result->success &&
+                       arrays_match(result->recovered_key, result->target_key, BLOCK_LENGTH));
+    cleanup_attack_result(result);
+
+    if (!secure_random_bytes(key, sizeof(key))) return failures + report("random key", 0);
+    int ok = square_attack_run(key, &run);
+    failures += report("square_attack_run recovers the key",
+                       ok && run.success && arrays_match(run.recovered_key, key, BLOCK_LENGTH));
+
+    // Sets come back from the pool, then the pool is emptied
+    lambda_set_t* first = create_lambda_set(0);
+    destroy_lambda_set(first);
+    lambda_set_t* second = create_lambda_set(3);
+    failures += report("create_lambda_set reuses pooled sets",
+                       second == first && second->active_position == 3 && !second->is_valid);
+    destroy_lambda_set(second);
+    square_attack_cleanup();
+    return failures;
+}
+
+/*
+ * lambda_set_transpose against a naive transpose, whole tiles and tails,
+ * at offsets that are not tile aligned
+ */
+static int test_transpose(void) {
+    static uint8_t blocks[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+    static uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+    static uint8_t expected[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+    static const size_t ranges[][2] = {{0, 256}, {0, 16}, {32, 48}, {5, 1}, {17, 200}, {250, 6}};
+    int match = 1;
+
+    if (!secure_random_bytes(blocks[0], sizeof(blocks))) return report("random inputs", 0);
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        size_t first = ranges[r][0], count = ranges[r][1];
+        memset(columns, 0xa5, sizeof(columns));
+        memset(expected, 0xa5, sizeof(expected));
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = 0; j < AES_BLOCK_SIZE; j++) {
+                expected[j][first + i] = blocks[i][j];
+            }
+        }
+        lambda_set_transpose((const uint8_t (*)[AES_BLOCK_SIZE])blocks, count, columns, first);
+        match &= memcmp(columns, expected, sizeof(columns)) == 0;
+    }
+    return report("lambda_set_transpose = naive transpose", match);
+}
+
+/*
+ * Capture files: sets written, closed, mapped and read back in place
+ */
+static int test_capture(void) {
+    static uint8_t sets[3][AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+    char path[] = "/tmp/self_test_capture_XXXXXX";
+    int failures = 0;
+
+    if (!secure_random_bytes(sets[0][0], sizeof(sets))) return report("random inputs", 0);
+    int fd = mkstemp(path);
+    if (fd < 0) return report("temporary file", 0);
+    close(fd);
+
+    square_capture_writer_t* writer = square_capture_create(path, 4, 0, 0x0001);
+    int written = writer != NULL;
+    for (size_t i = 0; written && i < 3; i++) {
+        written = square_capture_append(writer, (const uint8_t (*)[AES_LAMBDA_SET_SIZE])sets[i]) == 0;
+    }
+    written &= writer && square_capture_close(writer) == 0;
+    failures += report("capture written", written);
+
+    square_capture_t* capture = square_capture_open(path);
+    int match = capture != NULL;
+    if (capture) {
+        const square_capture_header_t* header = square_capture_header(capture);
+        match &= header->nrounds == 4 && header->lastfull == 0 && header->active_mask == 0x0001 &&
+                 square_capture_count(capture) == 3;
+        for (size_t i = 0; match && i < 3; i++) {
+            const uint8_t (*columns)[AES_LAMBDA_SET_SIZE] = square_capture_set(capture, i);
+            match &= ((uintptr_t)columns % 64) == 0 &&
+                     memcmp(columns, sets[i], SQUARE_CAPTURE_SET_SIZE) == 0;
+        }
+        square_capture_unmap(capture);
+    }
+    failures += report("square_capture_set reads back every set, aligned", match);
+
+    // Cut into the last set: no longer a capture
+    int truncated = truncate(path, sizeof(square_capture_header_t) + 2 * SQUARE_CAPTURE_SET_SIZE + 1) == 0;
+    capture = square_capture_open(path);
+    failures += report("truncated capture rejected", truncated && capture == NULL);
+    square_capture_unmap(capture);
+    unlink(path);
+    return failures;
+}
+
+// Shift-and-add product in GF(2^8), the textbook definition
+static uint8_t mul_naive(uint8_t a, uint8_t b) {
+    uint8_t product = 0;
+    for (; b; b >>= 1, a = xtime(a)) {
+        if (b & 1) product ^= a;
+    }
+    return product;
+}
+
+/*
+ * One set of key bytes through every psum stage, against the parity of
+ * z summed text by text
+ */
+static int check_psum(psum_t* ps, uint8_t* const planes[PSUM_STAGES], size_t count,
+                      const uint8_t multipliers[PSUM_STAGES], const uint8_t key[PSUM_STAGES]) {
+    uint64_t expected[4] = {0};
+
+    for (size_t n = 0; n < count; n++) {
+        uint8_t z = 0;
+        for (int j = 0; j < PSUM_STAGES; j++) {
+            z ^= mul_naive(multipliers[j], Sinv[planes[j][n] ^ key[j]]);
+        }
+        expected[z >> 6] ^= (uint64_t)1 << (z & 63);
+    }
+
+    psum_load(ps, (const uint8_t* const*)planes, count);
+    for (unsigned stage = 0; stage < PSUM_STAGES; stage++) {
+        psum_guess(ps, stage, key[stage]);
+    }
+    const column_parity_t* parity = psum_parity(ps);
+    int match = memcmp(parity->parity, expected, sizeof(expected)) == 0;
+    for (unsigned i = 0; i < parity->count; i++) {
+        uint8_t v = parity->values[i];
+        match &= (expected[v >> 6] >> (v & 63)) & 1;
+        match &= i == 0 || parity->values[i - 1] < v;
+    }
+    int odd = 0;
+    for (int w = 0; w < 4; w++) odd += __builtin_popcountll(expected[w]);
+    return match && parity->count == odd;
+}
+
+/*
+ * Partial sums against the naive sum: few texts, which are never reduced,
+ * then enough texts with repeated bytes that stages 2 and 3 are reduced
+ */
+static int test_psum(void) {
+    static const uint8_t multipliers[PSUM_STAGES] = {0x0e, 0x0b, 0x0d, 0x09};
+    static const struct {
+        const char* label;
+        size_t count;
+        uint8_t mask;           // fewer distinct bytes, more duplicates
+        int reduced;
+    } cases[] = {
+        {"psum = naive sum, 1000 texts, no reduction", 1000, 0xff, 0},
+        {"psum = naive sum, 2^18 texts, reduced", (size_t)1 << 18, 0x3f, 1},
+    };
+    psum_tables_t tables;
+    int failures = 0;
+
+    psum_tables_init(&tables, multipliers);
+    for (size_t t = 0; t < sizeof(cases) / sizeof(cases[0]); t++) {
+        size_t count = cases[t].count;
+        uint8_t* planes[PSUM_STAGES] = {NULL};
+        uint8_t keys[8][PSUM_STAGES];
+        psum_t ps;
+        int match = psum_init(&ps, &tables, count) == 0;
+
+        for (int j = 0; j < PSUM_STAGES; j++) {
+            planes[j] = malloc(count);
+            match &= planes[j] && secure_random_bytes(planes[j], count);
+            for (size_t n = 0; match && n < count; n++) planes[j][n] &= cases[t].mask;
+        }
+        match &= secure_random_bytes(keys[0], sizeof(keys));
+        for (int k = 0; match && k < 8; k++) {
+            match &= check_psum(&ps, planes, count, multipliers, keys[k]);
+            // Reduced stages shrink, the others keep every text
+            match &= (ps.stages[PSUM_STAGES - 1].count < count) == cases[t].reduced;
+        }
+        failures += report(cases[t].label, match);
+
+        psum_free(&ps);
+        for (int j = 0; j < PSUM_STAGES; j++) free(planes[j]);
+    }
+    return failures;
+}
+
+/*
+ * Every GF(2^8) kernel against the scalar one, in the AES field and in
+ * another, at unaligned offsets and lengths that leave vector tails.
+ * Then MixColumns followed by InvMixColumns must give the states back.
+ */
+static int test_gf(void) {
+    static gf_field_t other_field;
+    static uint8_t input[BATCH_MAX * 16 + 1], expected[BATCH_MAX * 16], output[BATCH_MAX * 16];
+    static uint8_t states[BATCH_MAX][16], mixed[BATCH_MAX][16], mixed_expected[BATCH_MAX][16];
+    uint8_t constants[] = {0x00, 0x01, 0x02, 0x53, 0xff, 0};
+    int failures = 0;
+
+    if (!secure_random_bytes(input, sizeof(input)) ||
+        !secure_random_bytes(states[0], sizeof(states)) ||
+        !secure_random_bytes(&constants[5], 1)) {
+        return report("random inputs", 0);
+    }
+
+    // The table product is the textbook one
+    const gf_field_t* aes = gf_aes_field();
+    int match = 1;
+    for (unsigned a = 0; a < 256; a++) {
+        for (unsigned b = 0; b < 256; b++) {
+            match &= gf_mul(aes, (uint8_t)a, (uint8_t)b) == mul_naive((uint8_t)a, (uint8_t)b);
+        }
+    }
+    failures += report("gf_mul = shift-and-add (AES field)", match);
+
+    // x^8 + x^4 + x^3 + x^2 + 1
+    if (gf_field_init(&other_field, 0x11d) != 0) return failures + report("field 0x11d", 0);
+    const gf_field_t* fields[] = {aes, &other_field};
+
+    match = gf_inverse(aes, 0) == 0 && gf_inverse(&other_field, 0) == 0;
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        for (unsigned a = 1; a < 256; a++) {
+            match &= gf_mul(fields[f], (uint8_t)a, gf_inverse(fields[f], (uint8_t)a)) == 1;
+        }
+    }
+    failures += report("gf_inverse(a) * a = 1, gf_inverse(0) = 0", match);
+
+    gf_impl_t saved_impl = gf_impl();
+    for (int impl = GF_IMPL_SCALAR; impl < GF_IMPL_COUNT; impl++) {
+        if (!gf_set_impl((gf_impl_t)impl)) continue;
+
+        int mul_match = 1, mix_match = 1, identity = 1;
+        for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+            const gf_field_t* field = fields[f];
+            for (size_t c = 0; c < sizeof(constants); c++) {
+                for (size_t s = 0; s < sizeof(batch_sizes) / sizeof(batch_sizes[0]); s++) {
+                    size_t count = batch_sizes[s] * 16 - 1;
+                    gf_set_impl(GF_IMPL_SCALAR);
+                    gf_mul_const_many(field, constants[c], input + 1, expected, count);
+                    gf_set_impl((gf_impl_t)impl);
+                    gf_mul_const_many(field, constants[c], input + 1, output, count);
+                    mul_match &= memcmp(output, expected, count) == 0;
+                }
+            }
+            for (size_t s = 0; s < sizeof(batch_sizes) / sizeof(batch_sizes[0]); s++) {
+                size_t count = batch_sizes[s];
+                for (int inverse = 0; inverse <= 1; inverse++) {
+                    const uint8_t* row = inverse ? field->inv_mix : field->mix;
+                    memcpy(mixed_expected, states, count * 16);
+                    memcpy(mixed, states, count * 16);
+                    gf_set_impl(GF_IMPL_SCALAR);
+                    gf_mix_many(field, row, mixed_expected, count);
+                    gf_set_impl((gf_impl_t)impl);
+                    gf_mix_many(field, row, mixed, count);
+                    mix_match &= memcmp(mixed, mixed_expected, count * 16) == 0;
+                }
+                memcpy(mixed, states, count * 16);
+                gf_mix_columns_many(field, mixed, count);
+                gf_inv_mix_columns_many(field, mixed, count);
+                identity &= memcmp(mixed, states, count * 16) == 0;
+            }
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "gf_mul_const_many (%s) = scalar", gf_impl_name((gf_impl_t)impl));
+        failures += report(label, mul_match);
+        snprintf(label, sizeof(label), "gf_mix_many (%s) = scalar", gf_impl_name((gf_impl_t)impl));
+        failures += report(label, mix_match);
+        snprintf(label, sizeof(label), "inv_mix after mix (%s) = identity", gf_impl_name((gf_impl_t)impl));
+        failures += report(label, identity);
+    }
+    gf_set_impl(saved_impl);
+    return failures;
+}
+
+/*
+ * The parameterized cipher with the AES parameters is AES: same round
+ * keys, and spn_enc_many_ks against aes128_enc at every round count.
+ * 0 rounds runs one, as the engine does.
+ */
+static int test_spn(void) {
+    static uint8_t inputs[BATCH_MAX][16], expected[BATCH_MAX][16], outputs[BATCH_MAX][16];
+    uint8_t key[16];
+    aes128_key_schedule_t ks, spn_ks;
+    int failures = 0;
+
+    const spn_cipher_t* aes = spn_aes();
+    if (!aes) return report("spn_aes", 0);
+    if (!secure_random_bytes(key, sizeof(key)) ||
+        !secure_random_bytes(inputs[0], sizeof(inputs))) {
+        return report("random inputs", 0);
+    }
+    aes128_expand_key(&ks, key);
+    spn_expand_key(aes, &spn_ks, key);
+    failures += report("spn_expand_key = aes128_expand_key", memcmp(ks.rk, spn_ks.rk, sizeof(ks.rk)) == 0);
+
+    int match = 1;
+    for (unsigned nrounds = 0; nrounds <= AES128_MAX_ROUNDS; nrounds++) {
+        for (int lastfull = 0; lastfull <= 1; lastfull++) {
+            memcpy(expected, inputs, sizeof(expected));
+            memcpy(outputs, inputs, sizeof(outputs));
+            for (size_t n = 0; n < BATCH_MAX; n++) {
+                aes128_enc(expected[n], key, nrounds ? nrounds : 1, lastfull);
+            }
+            spn_enc_many_ks(aes, outputs, BATCH_MAX, &spn_ks, nrounds, lastfull);
+            match &= memcmp(outputs, expected, sizeof(expected)) == 0;
+        }
+    }
+    failures += report("spn_enc_many_ks (spn_aes) = aes128_enc, 0-10 rounds", match);
+    return failures;
+}
+
+static const struct {
+    const char* name;
+    int (*run)(void);
+} tests[] = {
+    {"enc_many", test_enc_many},
+    {"aesni", test_aesni},
+    {"guess", test_guess},
+    {"square_api", test_square_api},
+    {"transpose", test_transpose},
+    {"capture", test_capture},
+    {"psum", test_psum},
+    {"gf", test_gf},
+    {"spn", test_spn},
+};
+
+int main(int argc, char* argv[]) {
+    int failures = 0;
+
+    printf("Self Test Program\n");
+    printf("=================\n");
+    for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+        int selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            selected |= strstr(tests[t].name, argv[i]) != NULL;
+        }
+        if (!selected) continue;
+
+        printf("\n=== %s ===\n", tests[t].name);
+        failures += tests[t].run();
+    }
+
+    printf("\n%d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
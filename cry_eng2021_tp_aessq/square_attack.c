@@ -0,0 +1,232 @@
+/**
+ * Square Attack Engine
+ * ====================
+ * Library implementation of the square_crypto.h API: lambda set storage,
+ * encryption through 3.5 rounds, per-byte key analysis and the full attack
+ */
+
+#include "square_crypto.h"
+#include "attack.h"
+#include "aes-128_enc.h"
+#include "aes-128_dec.h"
+#include "aes-128_engine.h"
+#include "square_guess.h"
+#include "square_lambda.h"
+#include "square_layout.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Free lambda sets kept per thread
+#define LAMBDA_SET_POOL_SIZE 8
+
+typedef struct {
+    lambda_set_t* sets[LAMBDA_SET_POOL_SIZE];
+    size_t count;
+    bool registered;
+} lambda_set_pool_t;
+
+static _Thread_local lambda_set_pool_t set_pool;
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+
+static void release_pool(void* p) {
+    lambda_set_pool_t* pool = p;
+    for (size_t i = 0; i < pool->count; i++) {
+        free(pool->sets[i]);
+    }
+    pool->count = 0;
+}
+
+static void pool_key_init(void) {
+    pthread_key_create(&pool_key, release_pool);
+}
+
+bool init_lambda_set(lambda_set_t* set, uint8_t active_byte_position) {
+    if (!set || active_byte_position >= BLOCK_LENGTH) return false;
+
+    // Random passive constants, the active byte takes all 256 values
+    if (lambda_sets_random(&set->plaintexts, 1, active_byte_position) != 0) return false;
+    set->active_position = active_byte_position;
+    set->is_valid = false;
+    return true;
+}
+
+lambda_set_t* create_lambda_set(uint8_t active_byte_position) {
+    lambda_set_t* set;
+
+    if (active_byte_position >= BLOCK_LENGTH) return NULL;
+
+    if (set_pool.count > 0) {
+        set = set_pool.sets[--set_pool.count];
+    } else {
+        set = aligned_alloc(LAMBDA_SET_ALIGNMENT, sizeof(*set));
+        if (!set) return NULL;
+    }
+
+    if (!init_lambda_set(set, active_byte_position)) {
+        destroy_lambda_set(set);
+        return NULL;
+    }
+    return set;
+}
+
+void destroy_lambda_set(lambda_set_t* set) {
+    if (!set) return;
+
+    if (!set_pool.registered) {
+        // Free the pooled sets when the thread exits
+        pthread_once(&pool_key_once, pool_key_init);
+        pthread_setspecific(pool_key, &set_pool);
+        set_pool.registered = true;
+    }
+    if (set_pool.count < LAMBDA_SET_POOL_SIZE) {
+        set_pool.sets[set_pool.count++] = set;
+    } else {
+        free(set);
+    }
+}
+
+void square_attack_cleanup(void) {
+    release_pool(&set_pool);
+}
+
+static void encrypt_lambda_set_ks(lambda_set_t* set, const aes128_key_schedule_t* ks) {
+    memcpy(set->ciphertexts, set->plaintexts, sizeof(set->ciphertexts));
+    aes128_enc_many_ks(set->ciphertexts, LAMBDA_SET_CARDINALITY, ks, AES_ROUNDS_3_5, 0);
+    lambda_set_transpose(set->ciphertexts, LAMBDA_SET_CARDINALITY, set->columns, 0);
+    set->is_valid = true;
+}
+
+bool encrypt_lambda_set(lambda_set_t* set, const uint8_t* master_key) {
+    if (!set || !master_key) return false;
+
+    aes128_key_schedule_t ks;
+    aes128_expand_key(&ks, master_key);
+    encrypt_lambda_set_ks(set, &ks);
+    return true;
+}
+
+bool analyze_key_byte(const lambda_set_t* set, uint8_t byte_position, key_byte_analysis_t* analysis) {
+    if (!set || !analysis || !set->is_valid || byte_position >= BLOCK_LENGTH) return false;
+
+    key_guess_set_t guesses;
+
+    // Same candidates as distinguisher() over every guess
+    square_guess_column(set->columns[byte_position], Sinv, &guesses);
+
+    analysis->count = 0;
+    for (unsigned guess = 0; guess < MAX_KEY_CANDIDATES; guess++) {
+        if (key_guess_set_has(&guesses, (uint8_t)guess)) {
+            analysis->candidates[analysis->count++] = (uint8_t)guess;
+        }
+    }
+    analysis->determined = analysis->count == 1;
+    analysis->final_key = analysis->determined ? analysis->candidates[0] : 0;
+    return true;
+}
+
+bool square_attack_run(const uint8_t* master_key, attack_result_t* result) {
+    if (!master_key || !result) return false;
+
+    memset(result, 0, sizeof(*result));
+    memcpy(result->target_key, master_key, BLOCK_LENGTH);
+
+    double start_time = get_timestamp_ms();
+    aes128_key_schedule_t ks;
+    aes128_expand_key(&ks, master_key);
+
+    lambda_set_t* set = create_lambda_set(0);
+    if (!set) return false;
+
+    // Votes for each key byte value across lambda sets
+    size_t votes[BLOCK_LENGTH][MAX_KEY_CANDIDATES] = {{0}};
+    size_t bytes_determined = 0;
+
+    while (bytes_determined < BLOCK_LENGTH) {
+        // Same bound as run_attack: a byte without a unique vote by then
+        // never gets one
+        if (result->lambda_sets_used >= ATTACK_MAX_LAMBDA_SETS) {
+            destroy_lambda_set(set);
+            return false;
+        }
+        if (result->lambda_sets_used > 0 && !init_lambda_set(set, 0)) {
+            destroy_lambda_set(set);
+            return false;
+        }
+
+        double phase_start = get_timestamp_ms();
+        encrypt_lambda_set_ks(set, &ks);
+        result->blocks_encrypted += LAMBDA_SET_CARDINALITY;
+        result->lambda_sets_used++;
+        double phase_end = get_timestamp_ms();
+        result->encryption_time += phase_end - phase_start;
+
+        for (uint8_t pos = 0; pos < BLOCK_LENGTH; pos++) {
+            key_byte_analysis_t* byte = &result->bytes[pos];
+            if (byte->determined) continue;
+
+            analyze_key_byte(set, pos, byte);
+            for (size_t i = 0; i < byte->count; i++) {
+                votes[pos][byte->candidates[i]]++;
+            }
+
+            // A unique candidate is the key byte; otherwise, after the first
+            // lambda set, a unique most voted value is
+            uint8_t voted;
+            if (!byte->determined && result->lambda_sets_used > 1 &&
+                most_common(votes[pos], &voted)) {
+                byte->final_key = voted;
+                byte->determined = true;
+            }
+            if (byte->determined) bytes_determined++;
+        }
+        result->analysis_time += get_timestamp_ms() - phase_end;
+    }
+    destroy_lambda_set(set);
+
+    // Derive master key using key schedule inversion
+    aes128_key_schedule_t recovered_ks;
+    for (size_t i = 0; i < BLOCK_LENGTH; i++) {
+        result->round_key[i] = result->bytes[i].final_key;
+    }
+    aes128_expand_key_from_round(&recovered_ks, result->round_key, 4);
+    memcpy(result->recovered_key, recovered_ks.rk[0], BLOCK_LENGTH);
+
+    result->success = arrays_match(result->recovered_key, master_key, BLOCK_LENGTH);
+    result->execution_time = get_timestamp_ms() - start_time;
+    return true;
+}
+
+attack_result_t* execute_square_attack(void) {
+    uint8_t key[BLOCK_LENGTH];
+    attack_result_t* result = malloc(sizeof(*result));
+
+    if (!result) return NULL;
+    if (!secure_random_bytes(key, BLOCK_LENGTH) || !square_attack_run(key, result)) {
+        free(result);
+        return NULL;
+    }
+    return result;
+}
+
+void print_attack_summary(const attack_result_t* result) {
+    if (!result) return;
+
+    printf("=== Attack Results ===\n");
+    format_hex_output(result->target_key, BLOCK_LENGTH, "Original Key");
+    format_hex_output(result->round_key, BLOCK_LENGTH, "4th Round Key");
+    format_hex_output(result->recovered_key, BLOCK_LENGTH, "Recovered Master Key");
+
+    printf("\n=== Attack Summary ===\n");
+    printf("Execution time: %.3f ms (encryption %.3f ms, analysis %.3f ms)\n",
+           result->execution_time, result->encryption_time, result->analysis_time);
+    printf("Lambda sets used: %zu\n", result->lambda_sets_used);
+    printf("Blocks encrypted: %zu\n", result->blocks_encrypted);
+    printf("Success: %s\n", result->success ? "YES" : "NO");
+}
+
+void cleanup_attack_result(attack_result_t* result) {
+    free(result);
+}
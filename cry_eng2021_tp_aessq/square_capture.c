@@ -0,0 +1,139 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "square_capture.h"
+
+_Static_assert(sizeof(square_capture_header_t) == 64, "capture header is 64 bytes");
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "capture headers are written in host order, little-endian only"
+#endif
+
+struct square_capture_writer {
+	FILE *file;
+	square_capture_header_t header;
+};
+
+struct square_capture {
+	const uint8_t *map;
+	size_t size;
+	const square_capture_header_t *header;
+};
+
+square_capture_writer_t *square_capture_create(const char *path, unsigned nrounds,
+											   int lastfull, uint16_t active_mask) {
+	square_capture_writer_t *writer = calloc(1, sizeof(*writer));
+	if (!writer) {
+		return NULL;
+	}
+
+	memcpy(writer->header.magic, SQUARE_CAPTURE_MAGIC, sizeof(writer->header.magic));
+	writer->header.version = SQUARE_CAPTURE_VERSION;
+	writer->header.nrounds = (uint8_t)nrounds;
+	writer->header.lastfull = (uint8_t)(lastfull != 0);
+	writer->header.active_mask = active_mask;
+
+	writer->file = fopen(path, "wb");
+	// set_count is still 0 here, fixed up on close
+	if (!writer->file ||
+		fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1) {
+		if (writer->file) {
+			fclose(writer->file);
+		}
+		free(writer);
+		return NULL;
+	}
+	return writer;
+}
+
+int square_capture_append(square_capture_writer_t *writer,
+						  const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE]) {
+	if (fwrite(columns, SQUARE_CAPTURE_SET_SIZE, 1, writer->file) != 1) {
+		return -1;
+	}
+	writer->header.set_count++;
+	return 0;
+}
+
+int square_capture_close(square_capture_writer_t *writer) {
+	int status = 0;
+
+	if (!writer) {
+		return 0;
+	}
+	if (fseek(writer->file, 0, SEEK_SET) != 0 ||
+		fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1) {
+		status = -1;
+	}
+	if (fclose(writer->file) != 0) {
+		status = -1;
+	}
+	free(writer);
+	return status;
+}
+
+square_capture_t *square_capture_open(const char *path) {
+	square_capture_t *capture = calloc(1, sizeof(*capture));
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if (!capture || fd < 0 || fstat(fd, &st) != 0 ||
+		(size_t)st.st_size < sizeof(square_capture_header_t)) {
+		goto fail;
+	}
+
+	capture->size = (size_t)st.st_size;
+	void *map = mmap(NULL, capture->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		goto fail;
+	}
+	close(fd);
+	fd = -1;
+	capture->map = map;
+	capture->header = map;
+
+	const square_capture_header_t *header = capture->header;
+	if (memcmp(header->magic, SQUARE_CAPTURE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != SQUARE_CAPTURE_VERSION ||
+		header->set_count > (capture->size - sizeof(*header)) / SQUARE_CAPTURE_SET_SIZE) {
+		square_capture_unmap(capture);
+		return NULL;
+	}
+	// Sets are read front to back
+	madvise(map, capture->size, MADV_SEQUENTIAL);
+	return capture;
+
+fail:
+	if (fd >= 0) {
+		close(fd);
+	}
+	free(capture);
+	return NULL;
+}
+
+void square_capture_unmap(square_capture_t *capture) {
+	if (!capture) {
+		return;
+	}
+	munmap((void *)capture->map, capture->size);
+	free(capture);
+}
+
+const square_capture_header_t *square_capture_header(const square_capture_t *capture) {
+	return capture->header;
+}
+
+size_t square_capture_count(const square_capture_t *capture) {
+	return capture->header->set_count;
+}
+
+const uint8_t (*square_capture_set(const square_capture_t *capture,
+								   size_t index))[AES_LAMBDA_SET_SIZE] {
+	return (const uint8_t (*)[AES_LAMBDA_SET_SIZE])
+		(capture->map + sizeof(square_capture_header_t) + index * SQUARE_CAPTURE_SET_SIZE);
+}
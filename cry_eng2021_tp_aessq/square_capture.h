@@ -0,0 +1,66 @@
+#ifndef SQUARE_CAPTURE_H
+#define SQUARE_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attack.h"
+
+/*
+ * Lambda-set capture files
+ * ========================
+ * A 64-byte header followed by the encrypted lambda sets, each stored
+ * column-major exactly as the guessing stage reads it:
+ * uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE], 4 KiB per set.
+ * Sets start on 64-byte boundaries, so a mapped capture is analyzed in
+ * place. All integers are little-endian.
+ */
+
+#define SQUARE_CAPTURE_MAGIC "SQCAPTUR"
+#define SQUARE_CAPTURE_VERSION 1
+#define SQUARE_CAPTURE_SET_SIZE (AES_BLOCK_SIZE * AES_LAMBDA_SET_SIZE)
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint8_t nrounds;        // aes128_enc contract of the ciphertexts
+	uint8_t lastfull;
+	uint16_t active_mask;   // bit j set when plaintext byte j is active
+	uint64_t set_count;
+	uint8_t reserved[40];
+} square_capture_header_t;
+
+/*
+ * Start a capture at @path. The set count is written on close.
+ */
+square_capture_writer_t *square_capture_create(const char *path, unsigned nrounds,
+                                               int lastfull, uint16_t active_mask);
+
+/*
+ * Append one encrypted lambda set. Returns 0 or -1.
+ */
+int square_capture_append(square_capture_writer_t *writer,
+                          const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE]);
+
+/*
+ * Finish the header and close. Returns 0 or -1.
+ */
+int square_capture_close(square_capture_writer_t *writer);
+
+/*
+ * Map a capture read-only. NULL if it is missing, truncated or not a
+ * capture.
+ */
+square_capture_t *square_capture_open(const char *path);
+void square_capture_unmap(square_capture_t *capture);
+
+const square_capture_header_t *square_capture_header(const square_capture_t *capture);
+size_t square_capture_count(const square_capture_t *capture);
+
+/*
+ * Columns of set @index, pointing into the mapping
+ */
+const uint8_t (*square_capture_set(const square_capture_t *capture,
+                                   size_t index))[AES_LAMBDA_SET_SIZE];
+
+#endif // SQUARE_CAPTURE_H
@@ -17,13 +17,21 @@
 #define LAMBDA_SET_CARDINALITY 256
 #define MAX_KEY_CANDIDATES 256
 #define AES_ROUNDS_3_5 4
+#define LAMBDA_SET_ALIGNMENT 64
 
 // Data structures
+
+// All arrays start on a cache line so SIMD passes can use aligned loads
 typedef struct {
-    uint8_t plaintexts[LAMBDA_SET_CARDINALITY][BLOCK_LENGTH];
-    uint8_t ciphertexts[LAMBDA_SET_CARDINALITY][BLOCK_LENGTH];
+    uint8_t plaintexts[LAMBDA_SET_CARDINALITY][BLOCK_LENGTH]
+        __attribute__((aligned(LAMBDA_SET_ALIGNMENT)));
+    uint8_t ciphertexts[LAMBDA_SET_CARDINALITY][BLOCK_LENGTH]
+        __attribute__((aligned(LAMBDA_SET_ALIGNMENT)));
+    // Ciphertexts transposed: columns[j][i] == ciphertexts[i][j]
+    uint8_t columns[BLOCK_LENGTH][LAMBDA_SET_CARDINALITY]
+        __attribute__((aligned(LAMBDA_SET_ALIGNMENT)));
     uint8_t active_position;
-    bool is_valid;
+    bool is_valid;              // ciphertexts and columns hold the encrypted plaintexts
 } lambda_set_t;
 
 typedef struct {
@@ -35,20 +43,38 @@ typedef struct {
 
 typedef struct {
     key_byte_analysis_t bytes[BLOCK_LENGTH];
-    uint8_t recovered_key[BLOCK_LENGTH];
+    uint8_t target_key[BLOCK_LENGTH];
+    uint8_t round_key[BLOCK_LENGTH];        // recovered 4th round key
+    uint8_t recovered_key[BLOCK_LENGTH];    // master key derived from it
     size_t lambda_sets_used;
-    double execution_time;
+    size_t blocks_encrypted;
+    double encryption_time;                 // ms spent in encrypt_lambda_set
+    double analysis_time;                   // ms spent in analyze_key_byte
+    double execution_time;                  // ms for the whole attack
     bool success;
 } attack_result_t;
 
 // Core cryptanalysis functions
+
+// Lambda sets come from a small per-thread pool: after warm-up, create and
+// destroy do not allocate
 lambda_set_t* create_lambda_set(uint8_t active_byte_position);
 void destroy_lambda_set(lambda_set_t* set);
+// Free the calling thread's pooled sets. Other threads release theirs when
+// they exit; the main thread has to call this before returning from main.
+void square_attack_cleanup(void);
+
+// Fill caller-provided storage with a fresh random lambda set
+bool init_lambda_set(lambda_set_t* set, uint8_t active_byte_position);
 
 bool encrypt_lambda_set(lambda_set_t* set, const uint8_t* master_key);
 bool analyze_key_byte(const lambda_set_t* set, uint8_t byte_position, key_byte_analysis_t* analysis);
 
+// Attack a random key; the result is released with cleanup_attack_result
 attack_result_t* execute_square_attack(void);
+// Attack @master_key through 3.5 rounds into caller-provided @result.
+// False if the lambda sets run out or cannot be generated.
+bool square_attack_run(const uint8_t* master_key, attack_result_t* result);
 void print_attack_summary(const attack_result_t* result);
 void cleanup_attack_result(attack_result_t* result);
 
@@ -0,0 +1,242 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "square_dist.h"
+#include "aes-128_enc.h"
+#include "aes-128_engine.h"
+#include "square_crypto.h"
+#include "square_lambda.h"
+
+#define DIST_BITS (8 * AES_BLOCK_SIZE)
+
+// Per-worker counters, merged once every task has run
+typedef struct {
+	uint64_t ones[DIST_BITS];
+	uint64_t flips[DIST_BITS][DIST_BITS];   // [input bit][output bit]
+	uint64_t flip_trials[DIST_BITS];
+	uint64_t integral_zero;
+	uint64_t bijective;
+	bool failed;
+} dist_counters_t;
+
+typedef struct {
+	const dist_config_t *config;
+	size_t batches;
+	dist_counters_t *counters;
+} dist_run_t;
+
+const char *dist_target_name(dist_target_t target) {
+	return target == DIST_TARGET_F ? "F" : "AES";
+}
+
+/*
+ * Fresh random key(s) for the target
+ */
+static int draw_key(const dist_config_t *config, aes128_f_key_t *key) {
+	uint8_t k[2][AES_128_KEY_SIZE];
+
+	if (!secure_random_bytes(k[0], sizeof(k))) {
+		return -1;
+	}
+	if (config->target == DIST_TARGET_F) {
+		aes128_f_init(key, k[0], k[1]);
+	} else {
+		aes128_expand_key(&key->ks1, k[0]);
+	}
+	return 0;
+}
+
+static void evaluate(const dist_config_t *config, const aes128_f_key_t *key,
+					 const uint8_t in[][AES_BLOCK_SIZE], uint8_t out[][AES_BLOCK_SIZE],
+					 size_t count) {
+	if (config->target == DIST_TARGET_F) {
+		aes128_f_many(key, in, out, count);
+	} else {
+		memcpy(out, in, count * AES_BLOCK_SIZE);
+		aes128_enc_many_ks(out, count, &key->ks1, config->nrounds, 0);
+	}
+}
+
+static void sample_batch(const dist_config_t *config, size_t count, dist_counters_t *counters) {
+	uint8_t in[DIST_BATCH][AES_BLOCK_SIZE];
+	uint8_t flipped[DIST_BATCH][AES_BLOCK_SIZE];
+	uint8_t out[DIST_BATCH][AES_BLOCK_SIZE];
+	uint8_t out_flipped[DIST_BATCH][AES_BLOCK_SIZE];
+	uint8_t flip_bit[DIST_BATCH];
+	aes128_f_key_t key;
+
+	if (draw_key(config, &key) != 0 ||
+		!secure_random_bytes(in[0], count * AES_BLOCK_SIZE) ||
+		!secure_random_bytes(flip_bit, count)) {
+		counters->failed = true;
+		return;
+	}
+	memcpy(flipped, in, count * AES_BLOCK_SIZE);
+	for (size_t n = 0; n < count; ++n) {
+		flip_bit[n] &= DIST_BITS - 1;
+		flipped[n][flip_bit[n] >> 3] ^= (uint8_t)(1u << (flip_bit[n] & 7));
+	}
+	evaluate(config, &key, (const uint8_t (*)[AES_BLOCK_SIZE])in, out, count);
+	evaluate(config, &key, (const uint8_t (*)[AES_BLOCK_SIZE])flipped, out_flipped, count);
+
+	for (size_t n = 0; n < count; ++n) {
+		uint64_t word[2], diff[2];
+		memcpy(word, out[n], sizeof(word));
+		memcpy(diff, out_flipped[n], sizeof(diff));
+		diff[0] ^= word[0];
+		diff[1] ^= word[1];
+
+		for (int w = 0; w < 2; ++w) {
+			for (int j = 0; j < 64; ++j) {
+				counters->ones[64 * w + j] += (word[w] >> j) & 1;
+			}
+		}
+		uint64_t *flips = counters->flips[flip_bit[n]];
+		counters->flip_trials[flip_bit[n]]++;
+		for (int w = 0; w < 2; ++w) {
+			for (uint64_t bits = diff[w]; bits; bits &= bits - 1) {
+				flips[64 * w + __builtin_ctzll(bits)]++;
+			}
+		}
+	}
+}
+
+static void sample_lambda_set(const dist_config_t *config, dist_counters_t *counters) {
+	uint8_t set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+	uint8_t out[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE];
+	aes128_f_key_t key;
+
+	if (draw_key(config, &key) != 0 || lambda_sets_random(&set, 1, 0) != 0) {
+		counters->failed = true;
+		return;
+	}
+	evaluate(config, &key, (const uint8_t (*)[AES_BLOCK_SIZE])set, out, AES_LAMBDA_SET_SIZE);
+
+	for (int j = 0; j < AES_BLOCK_SIZE; ++j) {
+		uint64_t seen[4] = {0};
+		uint8_t sum = 0;
+		for (int n = 0; n < AES_LAMBDA_SET_SIZE; ++n) {
+			sum ^= out[n][j];
+			seen[out[n][j] >> 6] |= (uint64_t)1 << (out[n][j] & 63);
+		}
+		counters->integral_zero += sum == 0;
+		counters->bijective += (seen[0] & seen[1] & seen[2] & seen[3]) == UINT64_MAX;
+	}
+}
+
+static void dist_task(void *arg, size_t index, unsigned worker) {
+	dist_run_t *run = arg;
+	dist_counters_t *counters = &run->counters[worker];
+
+	if (index < run->batches) {
+		size_t first = index * DIST_BATCH;
+		size_t left = run->config->samples - first;
+		sample_batch(run->config, left < DIST_BATCH ? left : DIST_BATCH, counters);
+	} else {
+		sample_lambda_set(run->config, counters);
+	}
+}
+
+/*
+ * z-score of a chi-square statistic with @df degrees of freedom
+ */
+static double chi2_z(double chi2, double df) {
+	return df > 0 ? (chi2 - df) / sqrt(2 * df) : 0.0;
+}
+
+int dist_run(square_pool_t *pool, const dist_config_t *config, dist_result_t *result) {
+	if (config->target == DIST_TARGET_AES &&
+		(config->nrounds < 1 || config->nrounds > AES128_MAX_ROUNDS)) {
+		return -1;
+	}
+
+	unsigned workers = pool ? square_pool_size(pool) : 1;
+	dist_run_t run = {config, (config->samples + DIST_BATCH - 1) / DIST_BATCH, NULL};
+	run.counters = calloc(workers, sizeof(*run.counters));
+	if (!run.counters) {
+		return -1;
+	}
+
+	double start = get_timestamp_ms();
+	size_t tasks = run.batches + config->lambda_sets;
+	if (pool) {
+		square_pool_parallel_for(pool, tasks, dist_task, &run);
+	} else {
+		for (size_t i = 0; i < tasks; ++i) {
+			dist_task(&run, i, 0);
+		}
+	}
+
+	// Merge into worker 0
+	dist_counters_t *total = &run.counters[0];
+	for (unsigned w = 1; w < workers; ++w) {
+		const dist_counters_t *c = &run.counters[w];
+		for (int i = 0; i < DIST_BITS; ++i) {
+			total->ones[i] += c->ones[i];
+			total->flip_trials[i] += c->flip_trials[i];
+			for (int j = 0; j < DIST_BITS; ++j) {
+				total->flips[i][j] += c->flips[i][j];
+			}
+		}
+		total->integral_zero += c->integral_zero;
+		total->bijective += c->bijective;
+		total->failed |= c->failed;
+	}
+	if (total->failed) {
+		free(run.counters);
+		return -1;
+	}
+
+	memset(result, 0, sizeof(*result));
+	result->samples = config->samples;
+	result->lambda_sets = config->lambda_sets;
+
+	double bytes = (double)config->lambda_sets * AES_BLOCK_SIZE;
+	if (bytes > 0) {
+		double p = 1.0 / 256;
+		result->integral_rate = total->integral_zero / bytes;
+		result->integral_z = (total->integral_zero - bytes * p) / sqrt(bytes * p * (1 - p));
+		result->bijective_rate = total->bijective / bytes;
+	}
+
+	// Each count is Binomial(trials, 1/2): (2 count - trials)^2 / trials is chi-square(1)
+	double n = (double)config->samples;
+	double chi2 = 0;
+	for (int j = 0; n > 0 && j < DIST_BITS; ++j) {
+		double d = 2.0 * total->ones[j] - n;
+		chi2 += d * d / n;
+		double bias = fabs(total->ones[j] / n - 0.5);
+		result->bias_max = bias > result->bias_max ? bias : result->bias_max;
+	}
+	result->bias_z = chi2_z(chi2, n > 0 ? DIST_BITS : 0);
+
+	double flips = 0, trials = 0, df = 0;
+	chi2 = 0;
+	for (int i = 0; i < DIST_BITS; ++i) {
+		double t = (double)total->flip_trials[i];
+		if (t == 0) {
+			continue;
+		}
+		trials += t;
+		df += DIST_BITS;
+		for (int j = 0; j < DIST_BITS; ++j) {
+			double f = (double)total->flips[i][j];
+			double d = 2.0 * f - t;
+			flips += f;
+			chi2 += d * d / t;
+			double bias = fabs(f / t - 0.5);
+			result->avalanche_max = bias > result->avalanche_max ? bias : result->avalanche_max;
+		}
+	}
+	result->avalanche_mean = trials > 0 ? flips / (trials * DIST_BITS) : 0.0;
+	result->avalanche_z = chi2_z(chi2, df);
+
+	result->distinguished = fabs(result->integral_z) > DIST_Z_THRESHOLD ||
+		fabs(result->bias_z) > DIST_Z_THRESHOLD ||
+		fabs(result->avalanche_z) > DIST_Z_THRESHOLD;
+	result->time_ms = get_timestamp_ms() - start;
+
+	free(run.counters);
+	return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef SQUARE_DIST_H
+#define SQUARE_DIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "square_pool.h"
+
+/*
+ * Distinguishing experiments
+ * ==========================
+ * Sample a keyed function on random (key, input) pairs and compare it with
+ * a random permutation:
+ * - integral: XOR sum of each output byte over a lambda set (active byte
+ *   0), zero with probability 1/256 if random
+ * - bit bias: P(output bit = 1), 1/2 if random
+ * - avalanche: P(output bit j flips | input bit i flipped), 1/2 for every
+ *   (i, j) if random (strict avalanche criterion)
+ * Every statistic is turned into a z-score under the random hypothesis; a
+ * target is distinguished when one exceeds DIST_Z_THRESHOLD.
+ * Samples are drawn in batches of DIST_BATCH inputs under one fresh key,
+ * on the worker pool, into per-worker counters merged at the end: memory
+ * does not grow with the sample count.
+ */
+
+#define DIST_BATCH 256
+#define DIST_Z_THRESHOLD 6.0
+
+typedef enum {
+	DIST_TARGET_AES,          // aes128_enc over nrounds, last round without MixColumns
+	DIST_TARGET_F             // F(k1||k2, x), AES128_F_ROUNDS rounds
+} dist_target_t;
+
+typedef struct {
+	dist_target_t target;
+	unsigned nrounds;         // AES only, 1...10
+	size_t samples;           // (key, input) pairs for bias and avalanche
+	size_t lambda_sets;       // for the integral test
+} dist_config_t;
+
+typedef struct {
+	size_t samples;
+	size_t lambda_sets;
+	double integral_rate;     // output bytes with a zero XOR sum, 1/256 if random
+	double integral_z;
+	double bijective_rate;    // output bytes taking all 256 values, ~0 if random
+	double bias_z;            // chi-square over the 128 output bits, as a z-score
+	double bias_max;          // largest |P(bit = 1) - 1/2|
+	double avalanche_mean;    // output bits flipped per input bit flipped, / 128
+	double avalanche_z;       // chi-square over the 128 x 128 flip counts
+	double avalanche_max;     // largest |P(flip) - 1/2|
+	double time_ms;
+	bool distinguished;
+} dist_result_t;
+
+/*
+ * Run every experiment of @config on @pool (NULL: inline). Returns 0 or -1.
+ */
+int dist_run(square_pool_t *pool, const dist_config_t *config, dist_result_t *result);
+
+const char *dist_target_name(dist_target_t target);
+
+#endif // SQUARE_DIST_H
@@ -0,0 +1,392 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "square_extend.h"
+#include "aes-128_enc.h"
+#include "aes-128_dec.h"
+#include "aes-128_engine.h"
+#include "square_crypto.h"
+#include "square_gf.h"
+#include "square_guess.h"
+#include "square_lambda.h"
+#include "square_layout.h"
+#include "square_log.h"
+#include "square_psum.h"
+
+#define EXTEND_NROUNDS 5
+
+// Per-worker counters, one cache line each
+typedef struct {
+	size_t columns_scored;
+	size_t guesses_tested;
+	char pad[64 - 2 * sizeof(size_t)];
+} extend_counters_t;
+
+typedef struct {
+	uint8_t key[4];           // last-round key bytes of the column, row order
+	uint8_t equivalent[4];    // k' byte of each row
+} column_guess_t;
+
+typedef struct {
+	unsigned nsets;
+	unsigned guessed_bytes;
+	// Encrypted sets, column-major
+	uint8_t (*columns)[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE];
+	// Column being attacked: ciphertext byte of each row, and the
+	// key bytes that are not guessed
+	uint8_t positions[4];
+	uint8_t known[4];
+	const gf_field_t *field;
+	extend_counters_t *counters;
+	// Row 0 partial sums, one per set for every worker
+	psum_tables_t tables;
+	psum_t (*sums)[EXTEND_MAX_SETS];
+	pthread_mutex_t lock;
+	column_guess_t survivors[EXTEND_MAX_SURVIVORS];
+	size_t survivor_count;
+} extend_t;
+
+/*
+ * Ciphertext byte that row @row of state column @column lands on after
+ * ShiftRows
+ */
+static unsigned shifted_position(unsigned column, unsigned row) {
+	return row + 4 * ((column - row) & 3);
+}
+
+/*
+ * Check one column guess against every row and set. Fills the k' bytes of
+ * @guess and returns true if it survives.
+ */
+static bool check_guess(extend_t *ext, column_guess_t *guess, extend_counters_t *counters) {
+	uint8_t z[AES_LAMBDA_SET_SIZE];
+
+	for (unsigned row = 0; row < 4; ++row) {
+		key_guess_set_t alive;
+		memset(&alive, 0xff, sizeof(alive));
+
+		for (unsigned set = 0; set < ext->nsets; ++set) {
+			const uint8_t (*columns)[AES_LAMBDA_SET_SIZE] = ext->columns[set];
+			// Undo the last round and one row of MixColumns for every text
+			for (size_t n = 0; n < AES_LAMBDA_SET_SIZE; ++n) {
+				uint8_t value = 0;
+				for (unsigned j = 0; j < 4; ++j) {
+					uint8_t w = Sinv[columns[ext->positions[j]][n] ^ guess->key[j]];
+					value ^= gf_mul(ext->field, ext->field->inv_mix[(j - row) & 3], w);
+				}
+				z[n] = value;
+			}
+
+			key_guess_set_t guesses;
+			square_guess_column(z, Sinv, &guesses);
+			counters->columns_scored++;
+			counters->guesses_tested += AES_KEY_BYTES_SIZE;
+
+			uint64_t any = 0;
+			for (int w = 0; w < 4; ++w) {
+				alive.bits[w] &= guesses.bits[w];
+				any |= alive.bits[w];
+			}
+			if (!any) {
+				return false;
+			}
+		}
+		for (int w = 0; w < 4; ++w) {
+			if (alive.bits[w]) {
+				guess->equivalent[row] = (uint8_t)(64 * w + __builtin_ctzll(alive.bits[w]));
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * Key byte @row of the column: every value when guessed, else the known
+ * one. The last rows are the guessed ones, so the stages of the known
+ * bytes are computed once and shared by every guess.
+ */
+static bool row_guessed(const extend_t *ext, unsigned row) {
+	return row >= 4 - ext->guessed_bytes;
+}
+
+static unsigned guess_range(const extend_t *ext, unsigned row) {
+	return row_guessed(ext, row) ? AES_KEY_BYTES_SIZE : 1;
+}
+
+static uint8_t guess_value(const extend_t *ext, unsigned row, unsigned value) {
+	return row_guessed(ext, row) ? (uint8_t)value : ext->known[row];
+}
+
+/*
+ * Guesses sharing key bytes 0 and 1 of the column (@index = k0 + 256 k1
+ * when both are guessed),
+ * row 0 first through partial sums. The few guesses keeping a row 0
+ * candidate in every set are checked on all rows by check_guess().
+ */
+static void guess_task(void *arg, size_t index, unsigned worker) {
+	extend_t *ext = arg;
+	psum_t *sums = ext->sums[worker];
+	extend_counters_t *counters = &ext->counters[worker];
+	column_guess_t guess;
+
+	guess.key[0] = guess_value(ext, 0, (unsigned)(index % guess_range(ext, 0)));
+	guess.key[1] = guess_value(ext, 1, (unsigned)(index / guess_range(ext, 0)));
+	for (unsigned set = 0; set < ext->nsets; ++set) {
+		const uint8_t *planes[PSUM_STAGES];
+		for (unsigned j = 0; j < PSUM_STAGES; ++j) {
+			planes[j] = ext->columns[set][ext->positions[j]];
+		}
+		psum_load(&sums[set], planes, AES_LAMBDA_SET_SIZE);
+		psum_guess(&sums[set], 0, guess.key[0]);
+		psum_guess(&sums[set], 1, guess.key[1]);
+	}
+
+	for (unsigned k2 = 0; k2 < guess_range(ext, 2); ++k2) {
+		guess.key[2] = guess_value(ext, 2, k2);
+		for (unsigned set = 0; set < ext->nsets; ++set) {
+			psum_guess(&sums[set], 2, guess.key[2]);
+		}
+
+		for (unsigned k3 = 0; k3 < guess_range(ext, 3); ++k3) {
+			guess.key[3] = guess_value(ext, 3, k3);
+			key_guess_set_t alive;
+			bool survives = true;
+			for (unsigned set = 0; set < ext->nsets && survives; ++set) {
+				key_guess_set_t guesses;
+				psum_guess(&sums[set], 3, guess.key[3]);
+				if (set == 0) {
+					square_guess_parity(psum_parity(&sums[set]), Sinv, &alive);
+					counters->guesses_tested += AES_KEY_BYTES_SIZE;
+				} else {
+					// Later sets only score the k' still alive
+					counters->guesses_tested +=
+						square_guess_parity_within(psum_parity(&sums[set]), Sinv,
+												   &alive, &guesses);
+					alive = guesses;
+				}
+				counters->columns_scored++;
+				survives = key_guess_set_count(&alive) > 0;
+			}
+			if (!survives || !check_guess(ext, &guess, counters)) {
+				continue;
+			}
+			pthread_mutex_lock(&ext->lock);
+			if (ext->survivor_count < EXTEND_MAX_SURVIVORS) {
+				ext->survivors[ext->survivor_count] = guess;
+			}
+			ext->survivor_count++;
+			pthread_mutex_unlock(&ext->lock);
+		}
+	}
+}
+
+static void run_parallel(square_pool_t *pool, size_t count,
+						 square_task_fn fn, void *arg) {
+	if (pool) {
+		square_pool_parallel_for(pool, count, fn, arg);
+	} else {
+		for (size_t i = 0; i < count; ++i) {
+			fn(arg, i, 0);
+		}
+	}
+}
+
+int recover_key_extended(square_pool_t *pool, square_oracle_t *oracle,
+						 const uint8_t key[AES_128_KEY_SIZE],
+						 const extend_config_t *config, attack_trial_t *trial) {
+	unsigned guessed = config->guessed_bytes;
+	unsigned nsets = config->lambda_sets ? config->lambda_sets : EXTEND_DEFAULT_SETS;
+	int lastfull = config->lastfull != 0;
+
+	if (guessed < 1 || guessed > 4 || nsets > EXTEND_MAX_SETS ||
+		(guessed < 4 && !key) || (!oracle && !key) ||
+		(oracle && (oracle->nrounds != EXTEND_NROUNDS || oracle->lastfull != lastfull))) {
+		return -1;
+	}
+	unsigned workers = pool ? square_pool_size(pool) : 1;
+	extend_t ext;
+	memset(&ext, 0, sizeof(ext));
+	ext.nsets = nsets;
+	ext.guessed_bytes = guessed;
+	ext.field = gf_aes_field();
+	uint8_t (*sets)[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE] = malloc(nsets * sizeof(*sets));
+	ext.columns = malloc(nsets * sizeof(*ext.columns));
+	ext.counters = calloc(workers, sizeof(*ext.counters));
+	ext.sums = calloc(workers, sizeof(*ext.sums));
+	int status = -1;
+	pthread_mutex_init(&ext.lock, NULL);
+	if (!sets || !ext.columns || !ext.counters || !ext.sums) {
+		goto out;
+	}
+
+	// Row 0 of InvMixColumns takes {0e, 0b, 0d, 09} times rows 0 to 3
+	psum_tables_init(&ext.tables, (const uint8_t[PSUM_STAGES]){0x0e, 0x0b, 0x0d, 0x09});
+	for (unsigned worker = 0; worker < workers; ++worker) {
+		for (unsigned set = 0; set < nsets; ++set) {
+			if (psum_init(&ext.sums[worker][set], &ext.tables, AES_LAMBDA_SET_SIZE) != 0) {
+				goto out;
+			}
+		}
+	}
+
+	double start_time = get_timestamp_ms();
+	memset(trial, 0, sizeof(*trial));
+
+	// Key bytes handed to the attack, in the form it guesses them
+	aes128_key_schedule_t ks;
+	uint8_t last_key[AES_BLOCK_SIZE] = {0};
+	if (key) {
+		aes128_expand_key(&ks, key);
+		memcpy(last_key, ks.rk[EXTEND_NROUNDS], AES_BLOCK_SIZE);
+		if (lastfull) {
+			gf_inv_mix_columns_many(ext.field, (uint8_t (*)[AES_BLOCK_SIZE])last_key, 1);
+		}
+	}
+
+	if (lambda_sets_random(sets, nsets, 0) != 0) {
+		goto out;
+	}
+	if (oracle) {
+		if (square_oracle_query(oracle, sets[0], nsets * AES_LAMBDA_SET_SIZE) != 0) {
+			goto out;
+		}
+	} else {
+		aes128_enc_many_ks(sets[0], nsets * AES_LAMBDA_SET_SIZE, &ks,
+						   EXTEND_NROUNDS, lastfull);
+	}
+	trial->blocks_encrypted = nsets * AES_LAMBDA_SET_SIZE;
+	if (lastfull) {
+		gf_inv_mix_columns_many(ext.field, sets[0], nsets * AES_LAMBDA_SET_SIZE);
+	}
+	for (unsigned set = 0; set < nsets; ++set) {
+		lambda_set_transpose(sets[set], AES_LAMBDA_SET_SIZE, ext.columns[set], 0);
+	}
+
+	// One column of the last round key at a time
+	uint8_t guessed_key[AES_BLOCK_SIZE] = {0};
+	bool unique = true;
+	for (unsigned column = 0; column < 4; ++column) {
+		for (unsigned row = 0; row < 4; ++row) {
+			ext.positions[row] = (uint8_t)shifted_position(column, row);
+			ext.known[row] = last_key[ext.positions[row]];
+		}
+		ext.survivor_count = 0;
+		run_parallel(pool, guess_range(&ext, 0) * guess_range(&ext, 1), guess_task, &ext);
+
+		const column_guess_t *found = &ext.survivors[0];
+		uint32_t packed = 0;
+		for (unsigned row = 0; ext.survivor_count && row < 4; ++row) {
+			packed |= (uint32_t)found->key[row] << (8 * row);
+		}
+		SQ_LOG_EVENT(SQ_LOG_INFO, SQ_EV_COLUMN_RECOVERED, column, ext.survivor_count, packed);
+		if (ext.survivor_count != 1) {
+			// Every row of the right guess survives: none means the
+			// ciphertexts do not match the round count
+			unique = false;
+			if (ext.survivor_count == 0) {
+				continue;
+			}
+		}
+		for (unsigned row = 0; row < 4; ++row) {
+			guessed_key[ext.positions[row]] = found->key[row];
+		}
+	}
+	square_log_flush();
+
+	// Last round key, then back to the master key
+	uint8_t round_key[AES_BLOCK_SIZE];
+	aes128_key_schedule_t recovered_ks;
+	memcpy(round_key, guessed_key, AES_BLOCK_SIZE);
+	if (lastfull) {
+		gf_mix_columns_many(ext.field, (uint8_t (*)[AES_BLOCK_SIZE])round_key, 1);
+	}
+	memcpy(trial->round_key, round_key, AES_BLOCK_SIZE);
+	aes128_expand_key_from_round(&recovered_ks, round_key, 5);
+	memcpy(trial->recovered_key, recovered_ks.rk[0], AES_128_KEY_SIZE);
+
+	trial->execution_time = get_timestamp_ms() - start_time;
+	trial->lambda_sets_used = nsets;
+	for (unsigned worker = 0; worker < workers; ++worker) {
+		trial->columns_scored += ext.counters[worker].columns_scored;
+		trial->guesses_tested += ext.counters[worker].guesses_tested;
+	}
+
+	if (key) {
+		memcpy(trial->key, key, AES_128_KEY_SIZE);
+		trial->success = unique && arrays_match(trial->recovered_key, key, AES_128_KEY_SIZE);
+	} else {
+		// The key is unknown: check the recovered one against one more query
+		uint8_t block[AES_BLOCK_SIZE];
+		uint8_t expected[AES_BLOCK_SIZE];
+		if (!secure_random_bytes(block, AES_BLOCK_SIZE)) {
+			goto out;
+		}
+		memcpy(expected, block, AES_BLOCK_SIZE);
+		aes128_enc(expected, trial->recovered_key, EXTEND_NROUNDS, lastfull);
+		if (square_oracle_query(oracle, &block, 1) != 0) {
+			goto out;
+		}
+		trial->blocks_encrypted++;
+		trial->success = unique && arrays_match(block, expected, AES_BLOCK_SIZE);
+	}
+	status = 0;
+
+out:
+	if (ext.sums) {
+		for (unsigned worker = 0; worker < workers; ++worker) {
+			for (unsigned set = 0; set < EXTEND_MAX_SETS; ++set) {
+				psum_free(&ext.sums[worker][set]);
+			}
+		}
+	}
+	pthread_mutex_destroy(&ext.lock);
+	free(ext.sums);
+	free(ext.counters);
+	free(ext.columns);
+	free(sets);
+	return status;
+}
+
+int aes128_attack_extended(square_pool_t *pool, square_oracle_t *oracle,
+						   const extend_config_t *config) {
+	const char *rounds = config->lastfull ? "5" : "4.5";
+	printf("=== Extended Square Attack (%s rounds) ===\n\n", rounds);
+
+	uint8_t key[AES_128_KEY_SIZE] = {0};
+	if (!oracle && !secure_random_bytes(key, AES_128_KEY_SIZE)) {
+		printf("Error: Failed to generate random key\n");
+		return -1;
+	}
+
+	printf("Guessing %u key bytes per column: 2^%u guesses per column\n",
+		   config->guessed_bytes, 8 * config->guessed_bytes + 8);
+
+	attack_trial_t trial;
+	if (recover_key_extended(pool, oracle, oracle ? NULL : key, config, &trial) != 0) {
+		printf(oracle ? "Error: Oracle query failed or unsupported oracle\n"
+					  : "Error: Attack setup failed\n");
+		return -1;
+	}
+
+	printf("=== Attack Results ===\n");
+	if (oracle) {
+		printf("Original Key        : held by the %s oracle\n", oracle->name);
+	} else {
+		format_hex_output(key, AES_128_KEY_SIZE, "Original Key");
+	}
+	format_hex_output(trial.round_key, AES_128_KEY_SIZE, "5th Round Key");
+	format_hex_output(trial.recovered_key, AES_128_KEY_SIZE, "Recovered Master Key");
+
+	printf("\n=== Attack Summary ===\n");
+	printf("Execution time: %.2f ms\n", trial.execution_time);
+	printf("Lambda sets used: %zu\n", trial.lambda_sets_used);
+	printf("Worker threads: %u\n", pool ? square_pool_size(pool) : 1);
+	printf("Blocks encrypted: %zu\n", trial.blocks_encrypted);
+	printf("Columns scored: %zu\n", trial.columns_scored);
+	printf("Guesses tested: %zu\n", trial.guesses_tested);
+	printf("Success: %s\n", trial.success ? "YES" : "NO");
+
+	return trial.success ? 0 : 1;
+}
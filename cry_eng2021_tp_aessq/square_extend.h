@@ -0,0 +1,53 @@
+#ifndef SQUARE_EXTEND_H
+#define SQUARE_EXTEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attack.h"
+
+/*
+ * Extended Square attack
+ * ======================
+ * 4.5 rounds (aes128_enc with nrounds = 5, lastfull = 0) or 5 rounds
+ * (lastfull = 1). The balanced byte sits one full round deeper than in
+ * the 3.5-round attack, so each column of the last round key is guessed
+ * together with one byte of the equivalent 4th round key
+ * k' = InvMixColumns(k4):
+ *
+ *   x = Sinv[(InvMixColumns(w))_r ^ k'_r],  w_j = Sinv[c_j ^ k5_j]
+ *
+ * over the 4 ciphertext bytes j that ShiftRows maps from one column, 2^40
+ * guesses per column. With a MixColumns in the last round, the
+ * ciphertexts go through InvMixColumns first and InvMixColumns(k5) is
+ * guessed instead. Every row r of the column is checked, a guess survives
+ * only if each row keeps a k'_r candidate in all lambda sets.
+ */
+
+#define EXTEND_DEFAULT_SETS 3
+#define EXTEND_MAX_SETS 8
+#define EXTEND_MAX_SURVIVORS 16
+
+typedef struct {
+	int lastfull;             // 0: 4.5 rounds, 1: 5 rounds
+	unsigned guessed_bytes;   // key bytes guessed per column, 1..4; the others
+	                          // are taken from the known key, for scaling runs
+	unsigned lambda_sets;     // sets every guess is checked against
+} extend_config_t;
+
+/*
+ * Recover the key through @oracle (nrounds = 5) or, if @oracle is NULL,
+ * of 5-round encryptions under @key. @config->guessed_bytes < 4 needs
+ * @key. Returns 0 with @trial filled, -1 on error.
+ */
+int recover_key_extended(square_pool_t *pool, square_oracle_t *oracle,
+                         const uint8_t key[AES_128_KEY_SIZE],
+                         const extend_config_t *config, attack_trial_t *trial);
+
+/*
+ * Driver: one recovery of a random key (or through @oracle) with a report
+ */
+int aes128_attack_extended(square_pool_t *pool, square_oracle_t *oracle,
+                           const extend_config_t *config);
+
+#endif // SQUARE_EXTEND_H
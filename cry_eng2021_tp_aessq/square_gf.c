@@ -0,0 +1,394 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "square_gf.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SQUARE_GF_X86 1
+#endif
+
+static const uint8_t aes_mix[4] = {0x02, 0x03, 0x01, 0x01};
+
+/*
+ * Shift-and-add product, only used to build the tables
+ */
+static uint8_t slow_mul(uint8_t a, uint8_t b, uint16_t polynomial) {
+	uint8_t product = 0;
+
+	for (; b; b >>= 1) {
+		if (b & 1) {
+			product ^= a;
+		}
+		a = (uint8_t)((a << 1) ^ ((a & 0x80) ? (polynomial & 0xff) : 0));
+	}
+	return product;
+}
+
+uint8_t gf_inverse(const gf_field_t *field, uint8_t a) {
+	uint8_t result = 1;
+
+	for (int e = 254; e; e >>= 1, a = gf_mul(field, a, a)) {
+		if (e & 1) {
+			result = gf_mul(field, result, a);
+		}
+	}
+	return result;
+}
+
+bool gf_irreducible(uint16_t polynomial) {
+	if ((polynomial >> 8) != 1) {
+		return false;
+	}
+	// Trial division by every polynomial of degree 1 to 4
+	for (unsigned divisor = 2; divisor < 32; ++divisor) {
+		unsigned degree = 31 - __builtin_clz(divisor);
+		unsigned rest = polynomial;
+		for (int bit = 8; bit >= (int)degree; --bit) {
+			if (rest & (1u << bit)) {
+				rest ^= divisor << (bit - degree);
+			}
+		}
+		if (rest == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int gf_field_init(gf_field_t *field, uint16_t polynomial) {
+	if (!gf_irreducible(polynomial)) {
+		return -1;
+	}
+	field->polynomial = polynomial;
+
+	for (unsigned c = 0; c < 256; ++c) {
+		for (unsigned n = 0; n < 16; ++n) {
+			field->lo[c][n] = slow_mul((uint8_t)c, (uint8_t)n, polynomial);
+			field->hi[c][n] = slow_mul((uint8_t)c, (uint8_t)(n << 4), polynomial);
+		}
+		// Byte 7 - i of the matrix selects the input bits of output bit i
+		uint64_t matrix = 0;
+		for (unsigned j = 0; j < 8; ++j) {
+			uint8_t column = slow_mul((uint8_t)c, (uint8_t)(1u << j), polynomial);
+			for (unsigned i = 0; i < 8; ++i) {
+				matrix |= (uint64_t)((column >> i) & 1) << (8 * (7 - i) + j);
+			}
+		}
+		field->affine[c] = matrix;
+	}
+
+	memcpy(field->mix, aes_mix, sizeof(field->mix));
+	if (gf_circulant_inverse(field, field->mix, field->inv_mix) != 0) {
+		return -1;
+	}
+	return 0;
+}
+
+static gf_field_t aes_field;
+static pthread_once_t aes_field_once = PTHREAD_ONCE_INIT;
+
+static void aes_field_init(void) {
+	gf_field_init(&aes_field, GF_AES_POLYNOMIAL);
+}
+
+const gf_field_t *gf_aes_field(void) {
+	pthread_once(&aes_field_once, aes_field_init);
+	return &aes_field;
+}
+
+int gf_circulant_inverse(const gf_field_t *field, const uint8_t row[4], uint8_t inverse[4]) {
+	// Gauss-Jordan on [M | I], M[r][j] = row[(j - r) & 3]
+	uint8_t m[4][8] = {{0}};
+	for (int r = 0; r < 4; ++r) {
+		for (int j = 0; j < 4; ++j) {
+			m[r][j] = row[(j - r) & 3];
+		}
+		m[r][4 + r] = 1;
+	}
+
+	for (int col = 0; col < 4; ++col) {
+		int pivot = col;
+		while (pivot < 4 && m[pivot][col] == 0) {
+			pivot++;
+		}
+		if (pivot == 4) {
+			return -1;
+		}
+		if (pivot != col) {
+			uint8_t tmp[8];
+			memcpy(tmp, m[col], 8);
+			memcpy(m[col], m[pivot], 8);
+			memcpy(m[pivot], tmp, 8);
+		}
+		uint8_t scale = gf_inverse(field, m[col][col]);
+		for (int j = 0; j < 8; ++j) {
+			m[col][j] = gf_mul(field, scale, m[col][j]);
+		}
+		for (int r = 0; r < 4; ++r) {
+			uint8_t factor = m[r][col];
+			if (r == col || factor == 0) {
+				continue;
+			}
+			for (int j = 0; j < 8; ++j) {
+				m[r][j] ^= gf_mul(field, factor, m[col][j]);
+			}
+		}
+	}
+
+	// The inverse of a circulant matrix is circulant
+	memcpy(inverse, &m[0][4], 4);
+	return 0;
+}
+
+// === Scalar ===
+
+static void mul_scalar(const gf_field_t *field, uint8_t c, const uint8_t *in,
+					   uint8_t *out, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = gf_mul(field, c, in[i]);
+	}
+}
+
+static void mix_scalar(const gf_field_t *field, const uint8_t row[4],
+					   uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	for (size_t n = 0; n < nblocks; ++n) {
+		for (int c = 0; c < AES_BLOCK_SIZE; c += 4) {
+			uint8_t in[4];
+			memcpy(in, blocks[n] + c, 4);
+			for (int r = 0; r < 4; ++r) {
+				uint8_t value = 0;
+				for (int k = 0; k < 4; ++k) {
+					value ^= gf_mul(field, row[k], in[(r + k) & 3]);
+				}
+				blocks[n][c + r] = value;
+			}
+		}
+	}
+}
+
+#ifdef SQUARE_GF_X86
+
+// Byte 4c + r <- byte 4c + ((r + k) & 3): the column rotated up by k
+#define ROTATE_MASK(k) _mm_setr_epi8( \
+	(0 + k) & 3, (1 + k) & 3, (2 + k) & 3, (3 + k) & 3, \
+	4 + ((0 + k) & 3), 4 + ((1 + k) & 3), 4 + ((2 + k) & 3), 4 + ((3 + k) & 3), \
+	8 + ((0 + k) & 3), 8 + ((1 + k) & 3), 8 + ((2 + k) & 3), 8 + ((3 + k) & 3), \
+	12 + ((0 + k) & 3), 12 + ((1 + k) & 3), 12 + ((2 + k) & 3), 12 + ((3 + k) & 3))
+
+__attribute__((target("ssse3")))
+static inline __m128i mul_ssse3_vec(__m128i v, __m128i lo, __m128i hi) {
+	__m128i nibble = _mm_set1_epi8(0x0f);
+	return _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(v, nibble)),
+						 _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+}
+
+__attribute__((target("ssse3")))
+static void mul_ssse3(const gf_field_t *field, uint8_t c, const uint8_t *in,
+					  uint8_t *out, size_t count) {
+	__m128i lo = _mm_loadu_si128((const __m128i *)field->lo[c]);
+	__m128i hi = _mm_loadu_si128((const __m128i *)field->hi[c]);
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		_mm_storeu_si128((__m128i *)(out + i), mul_ssse3_vec(v, lo, hi));
+	}
+	mul_scalar(field, c, in + i, out + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void mix_ssse3(const gf_field_t *field, const uint8_t row[4],
+					  uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	const __m128i rotate[4] = {ROTATE_MASK(0), ROTATE_MASK(1), ROTATE_MASK(2), ROTATE_MASK(3)};
+	__m128i lo[4], hi[4];
+
+	for (int k = 0; k < 4; ++k) {
+		lo[k] = _mm_loadu_si128((const __m128i *)field->lo[row[k]]);
+		hi[k] = _mm_loadu_si128((const __m128i *)field->hi[row[k]]);
+	}
+	for (size_t n = 0; n < nblocks; ++n) {
+		__m128i s = _mm_loadu_si128((const __m128i *)blocks[n]);
+		__m128i acc = _mm_setzero_si128();
+		for (int k = 0; k < 4; ++k) {
+			__m128i t = _mm_shuffle_epi8(s, rotate[k]);
+			acc = _mm_xor_si128(acc, row[k] == 1 ? t : mul_ssse3_vec(t, lo[k], hi[k]));
+		}
+		_mm_storeu_si128((__m128i *)blocks[n], acc);
+	}
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mul_avx2_vec(__m256i v, __m256i lo, __m256i hi) {
+	__m256i nibble = _mm256_set1_epi8(0x0f);
+	return _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+							_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+}
+
+__attribute__((target("avx2")))
+static void mul_avx2(const gf_field_t *field, uint8_t c, const uint8_t *in,
+					 uint8_t *out, size_t count) {
+	__m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)field->lo[c]));
+	__m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)field->hi[c]));
+	size_t i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		_mm256_storeu_si256((__m256i *)(out + i), mul_avx2_vec(v, lo, hi));
+	}
+	mul_scalar(field, c, in + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void mix_avx2(const gf_field_t *field, const uint8_t row[4],
+					 uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	__m256i rotate[4], lo[4], hi[4];
+	size_t n = 0;
+
+	rotate[0] = _mm256_broadcastsi128_si256(ROTATE_MASK(0));
+	rotate[1] = _mm256_broadcastsi128_si256(ROTATE_MASK(1));
+	rotate[2] = _mm256_broadcastsi128_si256(ROTATE_MASK(2));
+	rotate[3] = _mm256_broadcastsi128_si256(ROTATE_MASK(3));
+	for (int k = 0; k < 4; ++k) {
+		lo[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)field->lo[row[k]]));
+		hi[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)field->hi[row[k]]));
+	}
+	// Two states per register
+	for (; n + 2 <= nblocks; n += 2) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)blocks[n]);
+		__m256i acc = _mm256_setzero_si256();
+		for (int k = 0; k < 4; ++k) {
+			__m256i t = _mm256_shuffle_epi8(s, rotate[k]);
+			acc = _mm256_xor_si256(acc, row[k] == 1 ? t : mul_avx2_vec(t, lo[k], hi[k]));
+		}
+		_mm256_storeu_si256((__m256i *)blocks[n], acc);
+	}
+	mix_ssse3(field, row, blocks + n, nblocks - n);
+}
+
+__attribute__((target("gfni,avx2")))
+static void mul_gfni(const gf_field_t *field, uint8_t c, const uint8_t *in,
+					 uint8_t *out, size_t count) {
+	__m256i matrix = _mm256_set1_epi64x((long long)field->affine[c]);
+	size_t i = 0;
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_gf2p8affine_epi64_epi8(v, matrix, 0));
+	}
+	mul_scalar(field, c, in + i, out + i, count - i);
+}
+
+__attribute__((target("gfni,avx2")))
+static void mix_gfni(const gf_field_t *field, const uint8_t row[4],
+					 uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	__m256i rotate[4], matrix[4];
+	size_t n = 0;
+
+	rotate[0] = _mm256_broadcastsi128_si256(ROTATE_MASK(0));
+	rotate[1] = _mm256_broadcastsi128_si256(ROTATE_MASK(1));
+	rotate[2] = _mm256_broadcastsi128_si256(ROTATE_MASK(2));
+	rotate[3] = _mm256_broadcastsi128_si256(ROTATE_MASK(3));
+	for (int k = 0; k < 4; ++k) {
+		matrix[k] = _mm256_set1_epi64x((long long)field->affine[row[k]]);
+	}
+	for (; n + 2 <= nblocks; n += 2) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)blocks[n]);
+		__m256i acc = _mm256_setzero_si256();
+		for (int k = 0; k < 4; ++k) {
+			__m256i t = _mm256_shuffle_epi8(s, rotate[k]);
+			acc = _mm256_xor_si256(acc, row[k] == 1 ? t
+								   : _mm256_gf2p8affine_epi64_epi8(t, matrix[k], 0));
+		}
+		_mm256_storeu_si256((__m256i *)blocks[n], acc);
+	}
+	mix_ssse3(field, row, blocks + n, nblocks - n);
+}
+
+#endif // SQUARE_GF_X86
+
+typedef void (*mul_fn)(const gf_field_t *, uint8_t, const uint8_t *, uint8_t *, size_t);
+typedef void (*mix_fn)(const gf_field_t *, const uint8_t *, uint8_t (*)[AES_BLOCK_SIZE], size_t);
+
+static const struct {
+	const char *name;
+	mul_fn mul;
+	mix_fn mix;
+} impls[GF_IMPL_COUNT] = {
+	[GF_IMPL_AUTO]   = {"auto",   NULL,       NULL},
+	[GF_IMPL_SCALAR] = {"scalar", mul_scalar, mix_scalar},
+#ifdef SQUARE_GF_X86
+	[GF_IMPL_SSSE3]  = {"ssse3",  mul_ssse3,  mix_ssse3},
+	[GF_IMPL_AVX2]   = {"avx2",   mul_avx2,   mix_avx2},
+	[GF_IMPL_GFNI]   = {"gfni",   mul_gfni,   mix_gfni},
+#else
+	[GF_IMPL_SSSE3]  = {"ssse3",  NULL,       NULL},
+	[GF_IMPL_AVX2]   = {"avx2",   NULL,       NULL},
+	[GF_IMPL_GFNI]   = {"gfni",   NULL,       NULL},
+#endif
+};
+
+static gf_impl_t current_impl;
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+
+static bool impl_supported(gf_impl_t impl) {
+	switch (impl) {
+	case GF_IMPL_AUTO:
+	case GF_IMPL_SCALAR:
+		return true;
+#ifdef SQUARE_GF_X86
+	case GF_IMPL_SSSE3:
+		return __builtin_cpu_supports("ssse3");
+	case GF_IMPL_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case GF_IMPL_GFNI:
+		return __builtin_cpu_supports("gfni") && __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+static gf_impl_t resolve_impl(void) {
+	for (gf_impl_t impl = GF_IMPL_GFNI; impl > GF_IMPL_SCALAR; --impl) {
+		if (impl_supported(impl)) {
+			return impl;
+		}
+	}
+	return GF_IMPL_SCALAR;
+}
+
+static void impl_init(void) {
+	current_impl = resolve_impl();
+}
+
+bool gf_set_impl(gf_impl_t impl) {
+	pthread_once(&impl_once, impl_init);
+	if (!impl_supported(impl)) {
+		return false;
+	}
+	current_impl = (impl == GF_IMPL_AUTO) ? resolve_impl() : impl;
+	return true;
+}
+
+gf_impl_t gf_impl(void) {
+	pthread_once(&impl_once, impl_init);
+	return current_impl;
+}
+
+const char *gf_impl_name(gf_impl_t impl) {
+	if (impl < GF_IMPL_AUTO || impl >= GF_IMPL_COUNT) {
+		return "unknown";
+	}
+	return impls[impl].name;
+}
+
+void gf_mul_const_many(const gf_field_t *field, uint8_t c, const uint8_t *in,
+					   uint8_t *out, size_t count) {
+	impls[gf_impl()].mul(field, c, in, out, count);
+}
+
+void gf_mix_many(const gf_field_t *field, const uint8_t row[4],
+				 uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	impls[gf_impl()].mix(field, row, blocks, nblocks);
+}
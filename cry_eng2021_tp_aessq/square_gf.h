@@ -0,0 +1,106 @@
+#ifndef SQUARE_GF_H
+#define SQUARE_GF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes-128_enc.h"
+
+/*
+ * Batched GF(2^8) kernels
+ * =======================
+ * Multiplication by a constant, MixColumns and InvMixColumns over arrays
+ * of states, for any reduction polynomial. Multiplying by a constant c is
+ * linear over GF(2), so every field gets the same fast paths:
+ * - SSSE3/AVX2: c * v = lo[c][v & 15] ^ hi[c][v >> 4], two PSHUFB
+ * - GFNI: one GF2P8AFFINEQB with the 8x8 bit matrix of c
+ * States are AES blocks, byte 4 * column + row. A mixing layer is the
+ * circulant matrix whose first row is mix[0..3]:
+ * out_r = sum over k of mix[k] * in_{(r + k) & 3}.
+ */
+
+#define GF_AES_POLYNOMIAL 0x11b   // x^8 + x^4 + x^3 + x + 1
+
+typedef struct {
+	uint16_t polynomial;
+	uint8_t lo[256][16];      // lo[c][n] = c * n
+	uint8_t hi[256][16];      // hi[c][n] = c * (n << 4)
+	uint64_t affine[256];     // GF2P8AFFINEQB matrix of multiplication by c
+	uint8_t mix[4];           // MixColumns row, {02, 03, 01, 01}
+	uint8_t inv_mix[4];       // its inverse, {0e, 0b, 0d, 09} for AES
+} gf_field_t;
+
+typedef enum {
+	GF_IMPL_AUTO = 0,
+	GF_IMPL_SCALAR,
+	GF_IMPL_SSSE3,
+	GF_IMPL_AVX2,
+	GF_IMPL_GFNI,             // GFNI with AVX2, x86 only (cpuid)
+	GF_IMPL_COUNT
+} gf_impl_t;
+
+/*
+ * True if @polynomial has degree 8 and no factor
+ */
+bool gf_irreducible(uint16_t polynomial);
+
+/*
+ * Tables of GF(2)[X] / @polynomial, @polynomial of degree 8 with bit 8
+ * set. Returns 0, or -1 if it is not irreducible.
+ */
+int gf_field_init(gf_field_t *field, uint16_t polynomial);
+
+/*
+ * The AES field, built on first use
+ */
+const gf_field_t *gf_aes_field(void);
+
+static inline uint8_t gf_mul(const gf_field_t *field, uint8_t a, uint8_t b) {
+	return field->lo[a][b & 15] ^ field->hi[a][b >> 4];
+}
+
+/*
+ * Multiplicative inverse of @a as a^254, 0 for 0
+ */
+uint8_t gf_inverse(const gf_field_t *field, uint8_t a);
+
+/*
+ * First row of the inverse of the circulant matrix with first row @row.
+ * Returns 0, or -1 if it is singular.
+ */
+int gf_circulant_inverse(const gf_field_t *field, const uint8_t row[4], uint8_t inverse[4]);
+
+/*
+ * out[i] = @c * in[i] for @count bytes, @out may be @in
+ */
+void gf_mul_const_many(const gf_field_t *field, uint8_t c, const uint8_t *in,
+                       uint8_t *out, size_t count);
+
+/*
+ * Apply the circulant matrix with first row @row to every column of the
+ * @nblocks states of @blocks, in place
+ */
+void gf_mix_many(const gf_field_t *field, const uint8_t row[4],
+                 uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks);
+
+static inline void gf_mix_columns_many(const gf_field_t *field,
+                                       uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	gf_mix_many(field, field->mix, blocks, nblocks);
+}
+
+static inline void gf_inv_mix_columns_many(const gf_field_t *field,
+                                           uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	gf_mix_many(field, field->inv_mix, blocks, nblocks);
+}
+
+/*
+ * Force an implementation (AUTO picks the fastest one the CPU supports).
+ * Returns false if @impl is not supported on this machine.
+ * Not safe to call while other threads use the kernels.
+ */
+bool gf_set_impl(gf_impl_t impl);
+gf_impl_t gf_impl(void);
+const char *gf_impl_name(gf_impl_t impl);
+
+#endif // SQUARE_GF_H
@@ -0,0 +1,319 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "square_guess.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SQUARE_GUESS_X86 1
+#endif
+
+/*
+ * All implementations accumulate, for every ciphertext byte c, the whole
+ * vector sum[g] ^= Sinv[c ^ g] over the 256 guesses g. The vector versions
+ * note that Sinv[c ^ g] for the 16 guesses of a chunk is a PSHUFB of another
+ * 16-byte chunk of Sinv: chunk (g >> 4) ^ (c >> 4), indexed by (g & 15) ^ (c & 15).
+ */
+
+size_t key_guess_set_count(const key_guess_set_t *set) {
+	size_t count = 0;
+	for (int i = 0; i < 4; ++i) {
+		count += (size_t)__builtin_popcountll(set->bits[i]);
+	}
+	return count;
+}
+
+static void guess_scalar(const uint8_t *values, size_t count,
+						 const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	uint8_t sum[256] = {0};
+
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t c = values[i];
+		for (uint16_t guess = 0; guess < 256; ++guess) {
+			sum[guess] ^= Sbox_inv[c ^ guess];
+		}
+	}
+
+	memset(out, 0, sizeof(*out));
+	for (uint16_t guess = 0; guess < 256; ++guess) {
+		if (sum[guess] == 0) {
+			out->bits[guess >> 6] |= (uint64_t)1 << (guess & 63);
+		}
+	}
+}
+
+#ifdef SQUARE_GUESS_X86
+
+__attribute__((target("ssse3")))
+static void guess_ssse3(const uint8_t *values, size_t count,
+						const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+									   8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i table[16], acc[16];
+
+	for (int j = 0; j < 16; ++j) {
+		table[j] = _mm_loadu_si128((const __m128i *)(Sbox_inv + 16 * j));
+		acc[j] = _mm_setzero_si128();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		unsigned hi = values[i] >> 4;
+		__m128i idx = _mm_xor_si128(_mm_set1_epi8((char)(values[i] & 15)), iota);
+		for (unsigned j = 0; j < 16; ++j) {
+			acc[j] = _mm_xor_si128(acc[j], _mm_shuffle_epi8(table[j ^ hi], idx));
+		}
+	}
+
+	memset(out, 0, sizeof(*out));
+	for (int j = 0; j < 16; ++j) {
+		uint32_t zero = (uint32_t)_mm_movemask_epi8(
+			_mm_cmpeq_epi8(acc[j], _mm_setzero_si128()));
+		out->bits[j >> 2] |= (uint64_t)zero << (16 * (j & 3));
+	}
+}
+
+/*
+ * 32 guesses per register. PSHUFB only shuffles within 128-bit lanes, so
+ * bit 4 of c selects a copy of the table with its two lanes swapped.
+ */
+__attribute__((target("avx2")))
+static void guess_avx2(const uint8_t *values, size_t count,
+					   const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	const __m256i iota = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+										  8, 9, 10, 11, 12, 13, 14, 15,
+										  0, 1, 2, 3, 4, 5, 6, 7,
+										  8, 9, 10, 11, 12, 13, 14, 15);
+	__m256i table[2][8], acc[8];
+
+	for (int j = 0; j < 8; ++j) {
+		table[0][j] = _mm256_loadu_si256((const __m256i *)(Sbox_inv + 32 * j));
+		table[1][j] = _mm256_permute2x128_si256(table[0][j], table[0][j], 0x01);
+		acc[j] = _mm256_setzero_si256();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t c = values[i];
+		const __m256i *src = table[(c >> 4) & 1];
+		unsigned hi = c >> 5;
+		__m256i idx = _mm256_xor_si256(_mm256_set1_epi8((char)(c & 15)), iota);
+		for (unsigned j = 0; j < 8; ++j) {
+			acc[j] = _mm256_xor_si256(acc[j], _mm256_shuffle_epi8(src[j ^ hi], idx));
+		}
+	}
+
+	memset(out, 0, sizeof(*out));
+	for (int j = 0; j < 8; ++j) {
+		uint32_t zero = (uint32_t)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(acc[j], _mm256_setzero_si256()));
+		out->bits[j >> 1] |= (uint64_t)zero << (32 * (j & 1));
+	}
+}
+
+#endif // SQUARE_GUESS_X86
+
+typedef void (*guess_fn)(const uint8_t *, size_t, const uint8_t *, key_guess_set_t *);
+
+static const struct {
+	const char *name;
+	guess_fn fn;
+} impls[SQUARE_GUESS_IMPL_COUNT] = {
+	[SQUARE_GUESS_AUTO]   = {"auto",   NULL},
+	[SQUARE_GUESS_SCALAR] = {"scalar", guess_scalar},
+#ifdef SQUARE_GUESS_X86
+	[SQUARE_GUESS_SSSE3]  = {"ssse3",  guess_ssse3},
+	[SQUARE_GUESS_AVX2]   = {"avx2",   guess_avx2},
+#else
+	[SQUARE_GUESS_SSSE3]  = {"ssse3",  NULL},
+	[SQUARE_GUESS_AVX2]   = {"avx2",   NULL},
+#endif
+};
+
+static square_guess_impl_t current_impl;
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+
+static bool impl_supported(square_guess_impl_t impl) {
+	switch (impl) {
+	case SQUARE_GUESS_AUTO:
+	case SQUARE_GUESS_SCALAR:
+		return true;
+#ifdef SQUARE_GUESS_X86
+	case SQUARE_GUESS_SSSE3:
+		return __builtin_cpu_supports("ssse3");
+	case SQUARE_GUESS_AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+static square_guess_impl_t resolve_impl(void) {
+	if (impl_supported(SQUARE_GUESS_AVX2)) {
+		return SQUARE_GUESS_AVX2;
+	}
+	if (impl_supported(SQUARE_GUESS_SSSE3)) {
+		return SQUARE_GUESS_SSSE3;
+	}
+	return SQUARE_GUESS_SCALAR;
+}
+
+static void impl_init(void) {
+	current_impl = resolve_impl();
+}
+
+bool square_guess_set_impl(square_guess_impl_t impl) {
+	pthread_once(&impl_once, impl_init);
+	if (!impl_supported(impl)) {
+		return false;
+	}
+	current_impl = (impl == SQUARE_GUESS_AUTO) ? resolve_impl() : impl;
+	return true;
+}
+
+square_guess_impl_t square_guess_impl(void) {
+	pthread_once(&impl_once, impl_init);
+	return current_impl;
+}
+
+const char *square_guess_impl_name(square_guess_impl_t impl) {
+	if (impl < SQUARE_GUESS_AUTO || impl >= SQUARE_GUESS_IMPL_COUNT) {
+		return "unknown";
+	}
+	return impls[impl].name;
+}
+
+void square_guess_values(const uint8_t *values, size_t count,
+						 const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	impls[square_guess_impl()].fn(values, count, Sbox_inv, out);
+}
+
+void column_parity_build(column_parity_t *column, const uint8_t *values,
+						 size_t count, size_t stride) {
+	memset(column->parity, 0, sizeof(column->parity));
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t v = values[i * stride];
+		column->parity[v >> 6] ^= (uint64_t)1 << (v & 63);
+	}
+
+	column->count = 0;
+	for (int w = 0; w < 4; ++w) {
+		uint64_t bits = column->parity[w];
+		while (bits) {
+			column->values[column->count++] = (uint8_t)(64 * w + __builtin_ctzll(bits));
+			bits &= bits - 1;
+		}
+	}
+}
+
+void square_guess_parity(const column_parity_t *column,
+						 const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	if (column->count == 0) {
+		// Every sum is empty: all guesses pass
+		memset(out->bits, 0xff, sizeof(out->bits));
+		return;
+	}
+	square_guess_values(column->values, column->count, Sbox_inv, out);
+}
+
+size_t square_guess_parity_within(const column_parity_t *column,
+								  const uint8_t Sbox_inv[256],
+								  const key_guess_set_t *candidates,
+								  key_guess_set_t *out) {
+	size_t count = key_guess_set_count(candidates);
+
+	if (count > GUESS_WITHIN_MAX) {
+		square_guess_parity(column, Sbox_inv, out);
+		for (int w = 0; w < 4; ++w) {
+			out->bits[w] &= candidates->bits[w];
+		}
+		return AES_KEY_BYTES_SIZE;
+	}
+
+	memset(out, 0, sizeof(*out));
+	for (int w = 0; w < 4; ++w) {
+		uint64_t bits = candidates->bits[w];
+		while (bits) {
+			unsigned guess = 64 * w + __builtin_ctzll(bits);
+			uint8_t sum = 0;
+			for (uint16_t i = 0; i < column->count; ++i) {
+				sum ^= Sbox_inv[column->values[i] ^ guess];
+			}
+			if (sum == 0) {
+				out->bits[w] |= (uint64_t)1 << (guess & 63);
+			}
+			bits &= bits - 1;
+		}
+	}
+	return count;
+}
+
+void lambda_set_analysis_reset(lambda_set_analysis_t *analysis,
+							   const uint8_t Sbox_inv[256]) {
+	memset(analysis->evaluated, 0, sizeof(analysis->evaluated));
+	analysis->Sbox_inv = Sbox_inv;
+}
+
+void lambda_set_analysis_column(lambda_set_analysis_t *analysis,
+								const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+								size_t key_byte_index) {
+	column_parity_build(&analysis->columns[key_byte_index],
+						columns[key_byte_index], AES_LAMBDA_SET_SIZE, 1);
+	analysis->evaluated[key_byte_index] = false;
+}
+
+void lambda_set_analysis_init(lambda_set_analysis_t *analysis,
+							  const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+							  const uint8_t Sbox_inv[256]) {
+	lambda_set_analysis_reset(analysis, Sbox_inv);
+	for (size_t i = 0; i < AES_BLOCK_SIZE; ++i) {
+		lambda_set_analysis_column(analysis, columns, i);
+	}
+}
+
+const key_guess_set_t *lambda_set_analysis_guesses(lambda_set_analysis_t *analysis,
+												   size_t key_byte_index) {
+	if (!analysis->evaluated[key_byte_index]) {
+		square_guess_parity(&analysis->columns[key_byte_index],
+							analysis->Sbox_inv, &analysis->guesses[key_byte_index]);
+		analysis->evaluated[key_byte_index] = true;
+	}
+	return &analysis->guesses[key_byte_index];
+}
+
+const key_guess_set_t *lambda_set_analysis_guesses_within(lambda_set_analysis_t *analysis,
+														  size_t key_byte_index,
+														  const key_guess_set_t *candidates,
+														  size_t *scored) {
+	size_t count = 0;
+
+	if (!analysis->evaluated[key_byte_index]) {
+		count = square_guess_parity_within(&analysis->columns[key_byte_index],
+										   analysis->Sbox_inv, candidates,
+										   &analysis->guesses[key_byte_index]);
+		analysis->evaluated[key_byte_index] = true;
+	}
+	if (scored) {
+		*scored = count;
+	}
+	return &analysis->guesses[key_byte_index];
+}
+
+void square_guess_all(uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE],
+					  size_t key_byte_index, const uint8_t Sbox_inv[256],
+					  key_guess_set_t *out) {
+	column_parity_t column;
+
+	column_parity_build(&column, &lambda_set[0][key_byte_index],
+						AES_LAMBDA_SET_SIZE, AES_BLOCK_SIZE);
+	square_guess_parity(&column, Sbox_inv, out);
+}
+
+void square_guess_column(const uint8_t column[AES_LAMBDA_SET_SIZE],
+						 const uint8_t Sbox_inv[256], key_guess_set_t *out) {
+	column_parity_t reduced;
+
+	column_parity_build(&reduced, column, AES_LAMBDA_SET_SIZE, 1);
+	square_guess_parity(&reduced, Sbox_inv, out);
+}
@@ -0,0 +1,151 @@
+#ifndef SQUARE_GUESS_H
+#define SQUARE_GUESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attack.h"
+
+/*
+ * Key-guess engine
+ * ================
+ * Scores the 256 guesses for one last-round key byte in a single pass.
+ * For each guess g, sum(g) = XOR over the column of Sinv[c ^ g]; the guess
+ * survives when sum(g) == 0, exactly like distinguisher().
+ */
+
+// Bit g is set when guess g satisfies the distinguisher
+typedef struct {
+	uint64_t bits[4];
+} key_guess_set_t;
+
+/*
+ * Multiplicity reduction of one ciphertext column: values occurring an even
+ * number of times cancel in every sum, only the odd ones are kept
+ */
+typedef struct {
+	uint64_t parity[4];     // bit v set when v occurs an odd number of times
+	uint8_t values[256];    // the odd-multiplicity values, ascending
+	uint16_t count;
+} column_parity_t;
+
+/*
+ * Per lambda set cache: the 16 column reductions, built once, and the
+ * candidate sets computed from them on first use.
+ * Positions are independent: different threads may work on different
+ * positions of the same analysis.
+ */
+typedef struct {
+	column_parity_t columns[AES_BLOCK_SIZE];
+	key_guess_set_t guesses[AES_BLOCK_SIZE];
+	bool evaluated[AES_BLOCK_SIZE];     // guesses[i] is valid
+	const uint8_t *Sbox_inv;
+} lambda_set_analysis_t;
+
+typedef enum {
+	SQUARE_GUESS_AUTO = 0,
+	SQUARE_GUESS_SCALAR,
+	SQUARE_GUESS_SSSE3,
+	SQUARE_GUESS_AVX2,
+	SQUARE_GUESS_IMPL_COUNT
+} square_guess_impl_t;
+
+static inline bool key_guess_set_has(const key_guess_set_t *set, uint8_t guess) {
+	return (set->bits[guess >> 6] >> (guess & 63)) & 1;
+}
+
+size_t key_guess_set_count(const key_guess_set_t *set);
+
+/*
+ * Evaluate all guesses over @count ciphertext bytes @values
+ */
+void square_guess_values(const uint8_t *values, size_t count,
+                         const uint8_t Sbox_inv[256], key_guess_set_t *out);
+
+/*
+ * Evaluate all guesses for byte @key_byte_index of @lambda_set.
+ * Same candidates as calling distinguisher() for every guess.
+ */
+void square_guess_all(uint8_t lambda_set[AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE],
+                      size_t key_byte_index, const uint8_t Sbox_inv[256],
+                      key_guess_set_t *out);
+
+/*
+ * Evaluate all guesses over one contiguous column of a column-major set
+ */
+void square_guess_column(const uint8_t column[AES_LAMBDA_SET_SIZE],
+                         const uint8_t Sbox_inv[256], key_guess_set_t *out);
+
+/*
+ * Reduce @count bytes read every @stride bytes from @values
+ */
+void column_parity_build(column_parity_t *column, const uint8_t *values,
+                         size_t count, size_t stride);
+
+/*
+ * Evaluate all guesses over the odd-multiplicity values of @column
+ */
+void square_guess_parity(const column_parity_t *column,
+                         const uint8_t Sbox_inv[256], key_guess_set_t *out);
+
+/*
+ * Reduce the 16 columns of an encrypted column-major set and reset the cache
+ */
+void lambda_set_analysis_init(lambda_set_analysis_t *analysis,
+                              const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+                              const uint8_t Sbox_inv[256]);
+
+// Above this many candidates one pass over all 256 guesses is cheaper
+#define GUESS_WITHIN_MAX 16
+
+/*
+ * Evaluate only the guesses in @candidates, the result is a subset of it.
+ * Few candidates are scored one by one, many with the all-guess engine.
+ * Returns the number of guesses actually scored: the candidates, or all
+ * AES_KEY_BYTES_SIZE when the all-guess engine ran.
+ */
+size_t square_guess_parity_within(const column_parity_t *column,
+                                const uint8_t Sbox_inv[256],
+                                const key_guess_set_t *candidates,
+                                key_guess_set_t *out);
+
+/*
+ * Drop every cached candidate set and bind @Sbox_inv, without reducing
+ */
+void lambda_set_analysis_reset(lambda_set_analysis_t *analysis,
+                               const uint8_t Sbox_inv[256]);
+
+/*
+ * Reduce only column @key_byte_index of @columns and drop its cached
+ * candidates. Does not touch the other positions.
+ */
+void lambda_set_analysis_column(lambda_set_analysis_t *analysis,
+                                const uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+                                size_t key_byte_index);
+
+/*
+ * Candidate set for @key_byte_index, computed on first call then cached
+ */
+const key_guess_set_t *lambda_set_analysis_guesses(lambda_set_analysis_t *analysis,
+                                                   size_t key_byte_index);
+
+/*
+ * Same, restricted to @candidates when computed. Returns the cached set if
+ * @key_byte_index was already evaluated. If @scored is not NULL, it gets
+ * the guesses scored by this call (0 when cached).
+ */
+const key_guess_set_t *lambda_set_analysis_guesses_within(lambda_set_analysis_t *analysis,
+                                                          size_t key_byte_index,
+                                                          const key_guess_set_t *candidates,
+                                                          size_t *scored);
+
+/*
+ * Force an implementation (AUTO picks the widest one the CPU supports).
+ * Returns false if @impl is not supported on this machine.
+ * Not safe to call while other threads are scoring guesses.
+ */
+bool square_guess_set_impl(square_guess_impl_t impl);
+square_guess_impl_t square_guess_impl(void);
+const char *square_guess_impl_name(square_guess_impl_t impl);
+
+#endif // SQUARE_GUESS_H
@@ -0,0 +1,80 @@
+#include <string.h>
+
+#include "square_lambda.h"
+#include "square_crypto.h"
+
+// Sets whose constants come from one randomness draw
+#define RANDOM_BATCH_SETS 64
+
+int lambda_gen_init(lambda_gen_t *gen, uint16_t active_mask,
+					const uint8_t constants[AES_BLOCK_SIZE]) {
+	unsigned count = (unsigned)__builtin_popcount(active_mask);
+
+	if (count == 0 || count > LAMBDA_MAX_ACTIVE) {
+		return -1;
+	}
+
+	memcpy(gen->constants, constants, AES_BLOCK_SIZE);
+	gen->active_count = 0;
+	for (unsigned j = 0; j < AES_BLOCK_SIZE; ++j) {
+		if (active_mask & (1u << j)) {
+			gen->active[gen->active_count++] = (uint8_t)j;
+		}
+	}
+	gen->active_mask = active_mask;
+	gen->size = (uint64_t)1 << (8 * count);
+	gen->next = 0;
+	return 0;
+}
+
+int lambda_gen_init_random(lambda_gen_t *gen, uint16_t active_mask) {
+	uint8_t constants[AES_BLOCK_SIZE];
+
+	if (!secure_random_bytes(constants, AES_BLOCK_SIZE)) {
+		return -1;
+	}
+	return lambda_gen_init(gen, active_mask, constants);
+}
+
+size_t lambda_gen_fill(lambda_gen_t *gen, uint8_t blocks[][AES_BLOCK_SIZE], size_t max) {
+	uint64_t left = gen->size - gen->next;
+	size_t count = left < max ? (size_t)left : max;
+
+	for (size_t i = 0; i < count; ++i) {
+		uint64_t n = gen->next + i;
+		memcpy(blocks[i], gen->constants, AES_BLOCK_SIZE);
+		for (unsigned a = 0; a < gen->active_count; ++a) {
+			blocks[i][gen->active[a]] = (uint8_t)(n >> (8 * a));
+		}
+	}
+	gen->next += count;
+	return count;
+}
+
+void lambda_gen_rewind(lambda_gen_t *gen) {
+	gen->next = 0;
+}
+
+int lambda_sets_random(uint8_t sets[][AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE],
+					   size_t count, unsigned position) {
+	uint8_t constants[RANDOM_BATCH_SETS][AES_BLOCK_SIZE];
+
+	if (position >= AES_BLOCK_SIZE) {
+		return -1;
+	}
+
+	for (size_t first = 0; first < count; first += RANDOM_BATCH_SETS) {
+		size_t batch = count - first < RANDOM_BATCH_SETS ? count - first : RANDOM_BATCH_SETS;
+		if (!secure_random_bytes(constants[0], batch * AES_BLOCK_SIZE)) {
+			return -1;
+		}
+		for (size_t set = 0; set < batch; ++set) {
+			uint8_t (*blocks)[AES_BLOCK_SIZE] = sets[first + set];
+			for (size_t i = 0; i < AES_LAMBDA_SET_SIZE; ++i) {
+				memcpy(blocks[i], constants[set], AES_BLOCK_SIZE);
+				blocks[i][position] = (uint8_t)i;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef SQUARE_LAMBDA_H
+#define SQUARE_LAMBDA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attack.h"
+
+/*
+ * Lambda-set generator
+ * ====================
+ * A structure of plaintexts whose active bytes take every combination of
+ * values while the passive bytes hold fixed constants. With k active bytes
+ * it has 256^k blocks; block n gives the i-th active position (in
+ * ascending order) the value (n >> 8i) & 0xff, so the first active byte
+ * varies fastest. Blocks are produced in chunks, never all at once.
+ */
+
+#define LAMBDA_MAX_ACTIVE 4   // up to 2^32 blocks
+
+typedef struct {
+	uint8_t constants[AES_BLOCK_SIZE];  // active positions are ignored
+	uint8_t active[LAMBDA_MAX_ACTIVE];  // active positions, ascending
+	unsigned active_count;
+	uint16_t active_mask;               // bit j set when byte j is active
+	uint64_t size;                      // 256^active_count
+	uint64_t next;                      // index of the next block produced
+} lambda_gen_t;
+
+/*
+ * Structure with the active bytes of @active_mask and the passive
+ * @constants. Returns 0, or -1 for an empty or too wide mask.
+ */
+int lambda_gen_init(lambda_gen_t *gen, uint16_t active_mask,
+                    const uint8_t constants[AES_BLOCK_SIZE]);
+
+/*
+ * Same with random passive constants. Returns 0 or -1.
+ */
+int lambda_gen_init_random(lambda_gen_t *gen, uint16_t active_mask);
+
+/*
+ * Write up to @max next blocks of the structure to @blocks. Returns the
+ * number written, 0 once the structure is exhausted.
+ */
+size_t lambda_gen_fill(lambda_gen_t *gen, uint8_t blocks[][AES_BLOCK_SIZE], size_t max);
+
+/*
+ * Restart the structure from its first block
+ */
+void lambda_gen_rewind(lambda_gen_t *gen);
+
+/*
+ * Fill @count single-byte lambda sets active at @position, each with its
+ * own random constants. The randomness of a whole batch is drawn at once.
+ * Returns 0 or -1.
+ */
+int lambda_sets_random(uint8_t sets[][AES_LAMBDA_SET_SIZE][AES_BLOCK_SIZE],
+                       size_t count, unsigned position);
+
+#endif // SQUARE_LAMBDA_H
@@ -0,0 +1,82 @@
+#include <stdint.h>
+
+#include "square_layout.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/*
+ * Four interleave stages of doubling width: after the 8-bit stage every
+ * 16-bit element holds 2 rows of one column, after the 64-bit stage every
+ * register holds the 16 rows of one column.
+ */
+void square_transpose_16x16(const uint8_t *in, size_t in_stride,
+							uint8_t *out, size_t out_stride) {
+	__m128i r[16], t[16], u[16], v[16];
+
+	for (int i = 0; i < 16; ++i) {
+		r[i] = _mm_loadu_si128((const __m128i *)(in + i * in_stride));
+	}
+
+	// t[i]: columns 0-7, rows 2i and 2i+1; t[i + 8]: columns 8-15
+	for (int i = 0; i < 8; ++i) {
+		t[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+		t[i + 8] = _mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+	}
+	// u[4g + i]: columns 4g to 4g+3, rows 4i to 4i+3
+	for (int i = 0; i < 4; ++i) {
+		u[i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+		u[i + 4] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+		u[i + 8] = _mm_unpacklo_epi16(t[2 * i + 8], t[2 * i + 9]);
+		u[i + 12] = _mm_unpackhi_epi16(t[2 * i + 8], t[2 * i + 9]);
+	}
+	// v[4g], v[4g + 1]: columns 4g, 4g+1 and 4g+2, 4g+3, rows 0-7;
+	// v[4g + 2], v[4g + 3]: same columns, rows 8-15
+	for (int g = 0; g < 4; ++g) {
+		v[4 * g] = _mm_unpacklo_epi32(u[4 * g], u[4 * g + 1]);
+		v[4 * g + 1] = _mm_unpackhi_epi32(u[4 * g], u[4 * g + 1]);
+		v[4 * g + 2] = _mm_unpacklo_epi32(u[4 * g + 2], u[4 * g + 3]);
+		v[4 * g + 3] = _mm_unpackhi_epi32(u[4 * g + 2], u[4 * g + 3]);
+	}
+	for (int g = 0; g < 4; ++g) {
+		uint8_t *col = out + 4 * g * out_stride;
+		_mm_storeu_si128((__m128i *)col,
+						 _mm_unpacklo_epi64(v[4 * g], v[4 * g + 2]));
+		_mm_storeu_si128((__m128i *)(col + out_stride),
+						 _mm_unpackhi_epi64(v[4 * g], v[4 * g + 2]));
+		_mm_storeu_si128((__m128i *)(col + 2 * out_stride),
+						 _mm_unpacklo_epi64(v[4 * g + 1], v[4 * g + 3]));
+		_mm_storeu_si128((__m128i *)(col + 3 * out_stride),
+						 _mm_unpackhi_epi64(v[4 * g + 1], v[4 * g + 3]));
+	}
+}
+
+#else
+
+void square_transpose_16x16(const uint8_t *in, size_t in_stride,
+							uint8_t *out, size_t out_stride) {
+	for (size_t i = 0; i < 16; ++i) {
+		for (size_t j = 0; j < 16; ++j) {
+			out[j * out_stride + i] = in[i * in_stride + j];
+		}
+	}
+}
+
+#endif // __SSE2__
+
+void lambda_set_transpose(const uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+						  uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+						  size_t first) {
+	size_t i = 0;
+
+	for (; i + 16 <= nblocks; i += 16) {
+		square_transpose_16x16(blocks[i], AES_BLOCK_SIZE,
+							   &columns[0][first + i], AES_LAMBDA_SET_SIZE);
+	}
+	// Fewer than 16 blocks left: byte by byte
+	for (; i < nblocks; ++i) {
+		for (size_t j = 0; j < AES_BLOCK_SIZE; ++j) {
+			columns[j][first + i] = blocks[i][j];
+		}
+	}
+}
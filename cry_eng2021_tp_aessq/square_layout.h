@@ -0,0 +1,34 @@
+#ifndef SQUARE_LAYOUT_H
+#define SQUARE_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attack.h"
+
+/*
+ * Column-major lambda sets
+ * ========================
+ * The cipher works on blocks, one row of uint8_t[256][16] each, but key
+ * guessing scans one byte position over the whole set. The transpose turns
+ * a block-major set into 16 contiguous 256-byte columns:
+ * columns[j][i] == blocks[i][j].
+ */
+
+/*
+ * Transpose one 16x16 byte tile: out[j * out_stride + i] = in[i * in_stride + j]
+ */
+void square_transpose_16x16(const uint8_t *in, size_t in_stride,
+                            uint8_t *out, size_t out_stride);
+
+/*
+ * Transpose @nblocks blocks into entries [@first, @first + @nblocks) of
+ * every column. Whole 16x16 tiles take the SIMD path, the remainder is
+ * copied byte by byte.
+ * @first + @nblocks <= AES_LAMBDA_SET_SIZE
+ */
+void lambda_set_transpose(const uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks,
+                          uint8_t columns[AES_BLOCK_SIZE][AES_LAMBDA_SET_SIZE],
+                          size_t first);
+
+#endif // SQUARE_LAYOUT_H
@@ -0,0 +1,130 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "square_log.h"
+
+#define LOG_BUFFER_RECORDS 1024
+
+int square_log_level = SQ_LOG_NONE;
+
+static FILE *log_sink;
+static square_log_format_t log_format = SQ_LOG_FORMAT_TEXT;
+static pthread_mutex_t sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t next_thread_id;
+
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+// Per-thread buffer, only touched by its owner until handed to the sink
+typedef struct {
+	square_log_record_t records[LOG_BUFFER_RECORDS];
+	size_t count;
+	uint32_t thread;
+	bool registered;
+} log_buffer_t;
+
+static _Thread_local log_buffer_t buffer;
+
+static const struct {
+	const char *name;
+	const char *fields[3];
+	const char *text;
+} events[SQ_EV_COUNT] = {
+	[SQ_EV_GUESS] = {"guess", {"lambda_set", "byte", "guess"},
+		"lambda set %llu, byte %llu: guess %02llx survives"},
+	[SQ_EV_CANDIDATES] = {"candidates", {"lambda_set", "byte", "count"},
+		"lambda set %llu, byte %llu: %llu possible keys"},
+	[SQ_EV_BYTE_RECOVERED] = {"byte_recovered", {"lambda_set", "byte", "value"},
+		"lambda set %llu, byte %llu recovered: %02llx"},
+	[SQ_EV_PROGRESS] = {"progress", {"lambda_sets", "recovered", "remaining"},
+		"%llu lambda sets used, %llu key bytes recovered, %llu remaining"},
+	[SQ_EV_COLUMN_RECOVERED] = {"column_recovered", {"column", "survivors", "value"},
+		"key column %llu: %llu surviving guesses, last %08llx"},
+};
+
+static const char *level_names[] = {"none", "error", "warn", "info", "debug", "trace"};
+
+const char *square_log_level_name(int level) {
+	if (level < SQ_LOG_NONE || level > SQ_LOG_TRACE) {
+		return "unknown";
+	}
+	return level_names[level];
+}
+
+static void write_records(const log_buffer_t *buf) {
+	FILE *out;
+
+	pthread_mutex_lock(&sink_lock);
+	out = log_sink ? log_sink : stderr;
+	for (size_t i = 0; i < buf->count; ++i) {
+		const square_log_record_t *r = &buf->records[i];
+		unsigned long long a = r->a, b = r->b, c = r->c;
+
+		if (log_format == SQ_LOG_FORMAT_JSON) {
+			fprintf(out, "{\"ts_ns\": %llu, \"thread\": %u, \"level\": \"%s\", "
+					"\"event\": \"%s\", \"%s\": %llu, \"%s\": %llu, \"%s\": %llu}\n",
+					(unsigned long long)r->timestamp_ns, r->thread,
+					square_log_level_name(r->level), events[r->event].name,
+					events[r->event].fields[0], a,
+					events[r->event].fields[1], b,
+					events[r->event].fields[2], c);
+		} else {
+			fprintf(out, "[%-5s t%u] ", square_log_level_name(r->level), r->thread);
+			fprintf(out, events[r->event].text, a, b, c);
+			fputc('\n', out);
+		}
+	}
+	fflush(out);
+	pthread_mutex_unlock(&sink_lock);
+}
+
+static void flush_at_exit(void *unused) {
+	(void)unused;
+	square_log_flush();
+}
+
+static void exit_key_init(void) {
+	pthread_key_create(&exit_key, flush_at_exit);
+}
+
+void square_log_configure(int level, FILE *sink, square_log_format_t format) {
+	pthread_mutex_lock(&sink_lock);
+	log_sink = sink;
+	log_format = format;
+	pthread_mutex_unlock(&sink_lock);
+	square_log_level = level;
+}
+
+void square_log_record(int level, int event, uint64_t a, uint64_t b, uint64_t c) {
+	struct timespec ts;
+
+	if (!buffer.registered) {
+		// Flush whatever is left when the thread exits
+		pthread_once(&exit_key_once, exit_key_init);
+		pthread_setspecific(exit_key, &buffer);
+		buffer.thread = __atomic_fetch_add(&next_thread_id, 1, __ATOMIC_RELAXED);
+		buffer.registered = true;
+	}
+	if (buffer.count == LOG_BUFFER_RECORDS) {
+		square_log_flush();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	square_log_record_t *r = &buffer.records[buffer.count++];
+	r->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+	r->thread = buffer.thread;
+	r->event = (uint16_t)event;
+	r->level = (uint16_t)level;
+	r->a = a;
+	r->b = b;
+	r->c = c;
+}
+
+void square_log_flush(void) {
+	if (buffer.count == 0) {
+		return;
+	}
+	write_records(&buffer);
+	buffer.count = 0;
+}
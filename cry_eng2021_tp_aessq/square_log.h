@@ -0,0 +1,81 @@
+#ifndef SQUARE_LOG_H
+#define SQUARE_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Structured event log
+ * ====================
+ * Hot loops record fixed-size binary events into a per-thread buffer; text or
+ * JSON formatting only happens when a buffer is flushed. Events above
+ * SQUARE_LOG_MAX_LEVEL are removed at compile time, events above the runtime
+ * level cost one comparison.
+ */
+
+typedef enum {
+	SQ_LOG_NONE = 0,
+	SQ_LOG_ERROR,
+	SQ_LOG_WARN,
+	SQ_LOG_INFO,
+	SQ_LOG_DEBUG,
+	SQ_LOG_TRACE
+} square_log_level_t;
+
+#ifndef SQUARE_LOG_MAX_LEVEL
+#define SQUARE_LOG_MAX_LEVEL SQ_LOG_TRACE
+#endif
+
+typedef enum {
+	SQ_EV_GUESS = 0,         // a = lambda set, b = key byte index, c = surviving guess
+	SQ_EV_CANDIDATES,        // a = lambda set, b = key byte index, c = surviving guesses
+	SQ_EV_BYTE_RECOVERED,    // a = lambda set, b = key byte index, c = key byte
+	SQ_EV_PROGRESS,          // a = lambda sets used, b = bytes recovered, c = bytes remaining
+	SQ_EV_COLUMN_RECOVERED,  // a = key column, b = surviving guesses, c = last-round key column
+	SQ_EV_COUNT
+} square_log_event_t;
+
+typedef enum {
+	SQ_LOG_FORMAT_TEXT,
+	SQ_LOG_FORMAT_JSON       // one JSON object per line
+} square_log_format_t;
+
+typedef struct {
+	uint64_t timestamp_ns;   // CLOCK_MONOTONIC
+	uint32_t thread;         // small id, in order of first event
+	uint16_t event;
+	uint16_t level;
+	uint64_t a, b, c;
+} square_log_record_t;
+
+// Runtime level, SQ_LOG_NONE by default
+extern int square_log_level;
+
+#define SQ_LOG_ENABLED(level) \
+	((level) <= SQUARE_LOG_MAX_LEVEL && (level) <= square_log_level)
+
+#define SQ_LOG_EVENT(level, event, a, b, c) \
+	do { \
+		if (SQ_LOG_ENABLED(level)) { \
+			square_log_record((level), (event), (uint64_t)(a), (uint64_t)(b), (uint64_t)(c)); \
+		} \
+	} while (0)
+
+/*
+ * Set the runtime level and where flushed records go (stderr if @sink is NULL)
+ */
+void square_log_configure(int level, FILE *sink, square_log_format_t format);
+
+/*
+ * Append one record to the calling thread's buffer, flushing it when full
+ */
+void square_log_record(int level, int event, uint64_t a, uint64_t b, uint64_t c);
+
+/*
+ * Format and write the calling thread's buffered records
+ */
+void square_log_flush(void);
+
+const char *square_log_level_name(int level);
+
+#endif // SQUARE_LOG_H
@@ -0,0 +1,417 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "square_oracle.h"
+#include "aes-128_engine.h"
+
+#define RECORD_MAGIC "SQOR"
+#define RECORD_VERSION 1
+
+// Header of a recorded oracle file, followed by plaintext/ciphertext pairs
+typedef struct {
+	char magic[4];
+	uint8_t version;
+	uint8_t nrounds;
+	uint8_t lastfull;
+	uint8_t reserved;
+} record_header_t;
+
+static void count_query(square_oracle_t *oracle, size_t nblocks) {
+	__atomic_fetch_add(&oracle->blocks, nblocks, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&oracle->round_trips, 1, __ATOMIC_RELAXED);
+}
+
+void square_oracle_destroy(square_oracle_t *oracle) {
+	if (oracle) {
+		oracle->destroy(oracle);
+	}
+}
+
+// In-process oracle
+
+typedef struct {
+	square_oracle_t base;
+	aes128_key_schedule_t ks;
+} local_oracle_t;
+
+static int local_query(square_oracle_t *oracle, uint8_t blocks[][AES_BLOCK_SIZE],
+					   size_t nblocks) {
+	local_oracle_t *local = (local_oracle_t *)oracle;
+
+	aes128_enc_many_ks(blocks, nblocks, &local->ks, oracle->nrounds, oracle->lastfull);
+	count_query(oracle, nblocks);
+	return 0;
+}
+
+static void local_destroy(square_oracle_t *oracle) {
+	free(oracle);
+}
+
+square_oracle_t *square_oracle_local(const uint8_t key[AES_128_KEY_SIZE],
+									 unsigned nrounds, int lastfull) {
+	local_oracle_t *local = calloc(1, sizeof(*local));
+	if (!local) {
+		return NULL;
+	}
+	aes128_expand_key(&local->ks, key);
+	local->base.query = local_query;
+	local->base.destroy = local_destroy;
+	local->base.name = "local";
+	local->base.concurrent = true;
+	local->base.nrounds = nrounds;
+	local->base.lastfull = lastfull;
+	return &local->base;
+}
+
+// Socket stand-in server
+
+typedef struct {
+	square_oracle_t base;
+	int fd;
+	pid_t pid;
+} server_oracle_t;
+
+static ssize_t read_full(int fd, void *buf, size_t length) {
+	size_t done = 0;
+	while (done < length) {
+		ssize_t n = read(fd, (uint8_t *)buf + done, length - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return n < 0 ? -1 : (ssize_t)done;
+		}
+		done += (size_t)n;
+	}
+	return (ssize_t)done;
+}
+
+static int write_full(int fd, const void *buf, size_t length) {
+	size_t done = 0;
+	while (done < length) {
+		ssize_t n = send(fd, (const uint8_t *)buf + done, length - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+int square_oracle_serve(int fd, const uint8_t key[AES_128_KEY_SIZE],
+						unsigned nrounds, int lastfull) {
+	uint8_t frame[ORACLE_FRAME_BLOCKS][AES_BLOCK_SIZE];
+	aes128_key_schedule_t ks;
+
+	aes128_expand_key(&ks, key);
+	for (;;) {
+		uint32_t nblocks;
+		ssize_t n = read_full(fd, &nblocks, sizeof(nblocks));
+		if (n == 0) {
+			return 0;
+		}
+		if (n != sizeof(nblocks) || nblocks > ORACLE_FRAME_BLOCKS) {
+			return -1;
+		}
+		if (nblocks == 0) {
+			return 0;
+		}
+		if (read_full(fd, frame, nblocks * AES_BLOCK_SIZE) != (ssize_t)(nblocks * AES_BLOCK_SIZE)) {
+			return -1;
+		}
+		aes128_enc_many_ks(frame, nblocks, &ks, nrounds, lastfull);
+		if (write_full(fd, frame, nblocks * AES_BLOCK_SIZE) != 0) {
+			return -1;
+		}
+	}
+}
+
+/*
+ * Send every frame and read the replies in the same loop, so the server
+ * never waits for us to drain its answers. A reply only overwrites blocks
+ * whose frame was completely sent.
+ */
+static int server_query(square_oracle_t *oracle, uint8_t blocks[][AES_BLOCK_SIZE],
+						size_t nblocks) {
+	server_oracle_t *server = (server_oracle_t *)oracle;
+	size_t total = nblocks * AES_BLOCK_SIZE;
+	size_t received = 0;
+	size_t next_block = 0;      // first block of the frame being sent
+	size_t frame_sent = 0;      // bytes of that frame already sent, header included
+	uint32_t frame_blocks = 0;
+
+	while (received < total) {
+		struct pollfd pfd = {server->fd, POLLIN, 0};
+		if (next_block < nblocks) {
+			pfd.events |= POLLOUT;
+		}
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		if (pfd.revents & POLLIN) {
+			ssize_t n = recv(server->fd, (uint8_t *)blocks + received,
+							 total - received, MSG_DONTWAIT);
+			if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+				return -1;
+			}
+			if (n > 0) {
+				received += (size_t)n;
+			}
+		} else if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			return -1;
+		}
+
+		if ((pfd.revents & POLLOUT) && next_block < nblocks) {
+			if (frame_sent == 0) {
+				size_t left = nblocks - next_block;
+				frame_blocks = left < ORACLE_FRAME_BLOCKS ? (uint32_t)left : ORACLE_FRAME_BLOCKS;
+			}
+			struct iovec iov[2];
+			size_t header_left = frame_sent < sizeof(frame_blocks) ?
+				sizeof(frame_blocks) - frame_sent : 0;
+			size_t payload_sent = frame_sent - (sizeof(frame_blocks) - header_left);
+			int iovcnt = 0;
+			if (header_left) {
+				iov[iovcnt].iov_base = (uint8_t *)&frame_blocks + frame_sent;
+				iov[iovcnt++].iov_len = header_left;
+			}
+			iov[iovcnt].iov_base = (uint8_t *)blocks[next_block] + payload_sent;
+			iov[iovcnt++].iov_len = frame_blocks * AES_BLOCK_SIZE - payload_sent;
+
+			struct msghdr msg = {0};
+			msg.msg_iov = iov;
+			msg.msg_iovlen = (size_t)iovcnt;
+			ssize_t n = sendmsg(server->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (n < 0 && errno != EAGAIN && errno != EINTR) {
+				return -1;
+			}
+			if (n > 0) {
+				frame_sent += (size_t)n;
+				if (frame_sent == sizeof(frame_blocks) + frame_blocks * AES_BLOCK_SIZE) {
+					next_block += frame_blocks;
+					frame_sent = 0;
+				}
+			}
+		}
+	}
+	count_query(oracle, nblocks);
+	return 0;
+}
+
+static void server_destroy(square_oracle_t *oracle) {
+	server_oracle_t *server = (server_oracle_t *)oracle;
+	uint32_t shutdown = 0;
+
+	write_full(server->fd, &shutdown, sizeof(shutdown));
+	close(server->fd);
+	waitpid(server->pid, NULL, 0);
+	free(server);
+}
+
+square_oracle_t *square_oracle_server(const uint8_t key[AES_128_KEY_SIZE],
+									  unsigned nrounds, int lastfull) {
+	int fds[2];
+	server_oracle_t *server = calloc(1, sizeof(*server));
+	if (!server) {
+		return NULL;
+	}
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		free(server);
+		return NULL;
+	}
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		free(server);
+		return NULL;
+	}
+	if (pid == 0) {
+		// The key only lives in the server process from here on
+		close(fds[0]);
+		_exit(square_oracle_serve(fds[1], key, nrounds, lastfull) == 0 ? 0 : 1);
+	}
+
+	close(fds[1]);
+	server->fd = fds[0];
+	server->pid = pid;
+	server->base.query = server_query;
+	server->base.destroy = server_destroy;
+	server->base.name = "server";
+	server->base.concurrent = false;
+	server->base.nrounds = nrounds;
+	server->base.lastfull = lastfull;
+	return &server->base;
+}
+
+// Recording wrapper
+
+typedef struct {
+	square_oracle_t base;
+	square_oracle_t *inner;
+	FILE *file;
+	uint8_t (*plaintexts)[AES_BLOCK_SIZE];
+	size_t capacity;
+} record_oracle_t;
+
+static int record_query(square_oracle_t *oracle, uint8_t blocks[][AES_BLOCK_SIZE],
+						size_t nblocks) {
+	record_oracle_t *record = (record_oracle_t *)oracle;
+
+	if (nblocks > record->capacity) {
+		void *grown = realloc(record->plaintexts, nblocks * AES_BLOCK_SIZE);
+		if (!grown) {
+			return -1;
+		}
+		record->plaintexts = grown;
+		record->capacity = nblocks;
+	}
+	memcpy(record->plaintexts, blocks, nblocks * AES_BLOCK_SIZE);
+	if (square_oracle_query(record->inner, blocks, nblocks) != 0) {
+		return -1;
+	}
+	for (size_t i = 0; i < nblocks; ++i) {
+		if (fwrite(record->plaintexts[i], AES_BLOCK_SIZE, 1, record->file) != 1 ||
+			fwrite(blocks[i], AES_BLOCK_SIZE, 1, record->file) != 1) {
+			return -1;
+		}
+	}
+	count_query(oracle, nblocks);
+	return 0;
+}
+
+static void record_destroy(square_oracle_t *oracle) {
+	record_oracle_t *record = (record_oracle_t *)oracle;
+
+	fclose(record->file);
+	square_oracle_destroy(record->inner);
+	free(record->plaintexts);
+	free(record);
+}
+
+square_oracle_t *square_oracle_record(square_oracle_t *inner, const char *path) {
+	record_oracle_t *record = calloc(1, sizeof(*record));
+	record_header_t header = {RECORD_MAGIC, RECORD_VERSION,
+							  (uint8_t)inner->nrounds, (uint8_t)inner->lastfull, 0};
+
+	if (!record) {
+		return NULL;
+	}
+	record->file = fopen(path, "wb");
+	if (!record->file || fwrite(&header, sizeof(header), 1, record->file) != 1) {
+		if (record->file) {
+			fclose(record->file);
+		}
+		free(record);
+		return NULL;
+	}
+	record->inner = inner;
+	record->base.query = record_query;
+	record->base.destroy = record_destroy;
+	record->base.name = "record";
+	record->base.concurrent = false;
+	record->base.nrounds = inner->nrounds;
+	record->base.lastfull = inner->lastfull;
+	return &record->base;
+}
+
+// Replay from a recording
+
+typedef struct {
+	uint8_t plaintext[AES_BLOCK_SIZE];
+	uint8_t ciphertext[AES_BLOCK_SIZE];
+} recorded_pair_t;
+
+typedef struct {
+	square_oracle_t base;
+	recorded_pair_t *pairs;     // sorted by plaintext
+	size_t count;
+} replay_oracle_t;
+
+static int compare_pairs(const void *a, const void *b) {
+	return memcmp(a, b, AES_BLOCK_SIZE);
+}
+
+static int replay_query(square_oracle_t *oracle, uint8_t blocks[][AES_BLOCK_SIZE],
+						size_t nblocks) {
+	replay_oracle_t *replay = (replay_oracle_t *)oracle;
+
+	for (size_t i = 0; i < nblocks; ++i) {
+		const recorded_pair_t *pair = bsearch(blocks[i], replay->pairs, replay->count,
+											  sizeof(*replay->pairs), compare_pairs);
+		if (!pair) {
+			return -1;
+		}
+		memcpy(blocks[i], pair->ciphertext, AES_BLOCK_SIZE);
+	}
+	count_query(oracle, nblocks);
+	return 0;
+}
+
+static void replay_destroy(square_oracle_t *oracle) {
+	replay_oracle_t *replay = (replay_oracle_t *)oracle;
+
+	free(replay->pairs);
+	free(replay);
+}
+
+square_oracle_t *square_oracle_replay(const char *path) {
+	replay_oracle_t *replay = calloc(1, sizeof(*replay));
+	record_header_t header;
+	FILE *file = fopen(path, "rb");
+	long size;
+
+	if (!replay || !file) {
+		goto fail;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != RECORD_VERSION) {
+		goto fail;
+	}
+	if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 ||
+		fseek(file, sizeof(header), SEEK_SET) != 0) {
+		goto fail;
+	}
+
+	replay->count = ((size_t)size - sizeof(header)) / sizeof(*replay->pairs);
+	replay->pairs = malloc(replay->count * sizeof(*replay->pairs) + 1);
+	if (!replay->pairs ||
+		fread(replay->pairs, sizeof(*replay->pairs), replay->count, file) != replay->count) {
+		goto fail;
+	}
+	fclose(file);
+	qsort(replay->pairs, replay->count, sizeof(*replay->pairs), compare_pairs);
+
+	replay->base.query = replay_query;
+	replay->base.destroy = replay_destroy;
+	replay->base.name = "replay";
+	replay->base.concurrent = true;
+	replay->base.nrounds = header.nrounds;
+	replay->base.lastfull = header.lastfull;
+	return &replay->base;
+
+fail:
+	if (file) {
+		fclose(file);
+	}
+	if (replay) {
+		free(replay->pairs);
+		free(replay);
+	}
+	return NULL;
+}
@@ -0,0 +1,79 @@
+#ifndef SQUARE_ORACLE_H
+#define SQUARE_ORACLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes-128_enc.h"
+
+/*
+ * Encryption oracles
+ * ==================
+ * The attack only sees an oracle that encrypts batches of chosen
+ * plaintexts. A whole batch is one round trip: the socket oracle streams it
+ * as pipelined frames of ORACLE_FRAME_BLOCKS blocks and collects the
+ * replies while it is still sending.
+ */
+
+#define ORACLE_FRAME_BLOCKS 256
+
+typedef struct square_oracle square_oracle_t;
+
+struct square_oracle {
+	/*
+	 * Replace the @nblocks chosen plaintexts of @blocks by their
+	 * ciphertexts. Returns 0 on success, -1 on failure.
+	 */
+	int (*query)(square_oracle_t *oracle, uint8_t blocks[][AES_BLOCK_SIZE],
+	             size_t nblocks);
+	void (*destroy)(square_oracle_t *oracle);
+	const char *name;
+	bool concurrent;        // query may run on several threads at once
+	unsigned nrounds;       // aes128_enc contract of the answers
+	int lastfull;
+	uint64_t blocks;        // blocks answered, updated atomically
+	uint64_t round_trips;   // query calls
+};
+
+/*
+ * Encrypt in process with @key, thread-safe
+ */
+square_oracle_t *square_oracle_local(const uint8_t key[AES_128_KEY_SIZE],
+                                     unsigned nrounds, int lastfull);
+
+/*
+ * Fork a stand-in server holding @key, reached over a Unix socket pair.
+ * Create it before starting threads.
+ */
+square_oracle_t *square_oracle_server(const uint8_t key[AES_128_KEY_SIZE],
+                                      unsigned nrounds, int lastfull);
+
+/*
+ * Server side of the socket protocol: answer frames read from @fd until it
+ * is closed or an empty frame arrives. Returns 0 on a clean shutdown.
+ */
+int square_oracle_serve(int fd, const uint8_t key[AES_128_KEY_SIZE],
+                        unsigned nrounds, int lastfull);
+
+/*
+ * Forward queries to @inner and append every plaintext/ciphertext pair to
+ * @path. Takes ownership of @inner.
+ */
+square_oracle_t *square_oracle_record(square_oracle_t *inner, const char *path);
+
+/*
+ * Answer from the pairs recorded in @path. A plaintext that was never
+ * recorded fails the query.
+ */
+square_oracle_t *square_oracle_replay(const char *path);
+
+static inline int square_oracle_query(square_oracle_t *oracle,
+                                      uint8_t blocks[][AES_BLOCK_SIZE],
+                                      size_t nblocks) {
+	return oracle->query(oracle, blocks, nblocks);
+}
+
+void square_oracle_destroy(square_oracle_t *oracle);
+
+#endif // SQUARE_ORACLE_H
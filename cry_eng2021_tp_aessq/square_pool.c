@@ -0,0 +1,251 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "square_pool.h"
+
+// Task range owned by a worker, padded to its own cache line
+typedef struct {
+	pthread_mutex_t lock;
+	size_t lo;
+	size_t hi;
+	char pad[64];
+} worker_range_t;
+
+typedef struct {
+	square_pool_t *pool;
+	unsigned id;
+} worker_arg_t;
+
+struct square_pool {
+	unsigned size;
+	pthread_t *threads;
+	worker_arg_t *args;
+	worker_range_t *ranges;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	uint64_t generation;
+	unsigned running;
+	bool stop;
+
+	square_task_fn fn;
+	void *arg;
+};
+
+unsigned square_cpu_count(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned)n : 1;
+}
+
+/*
+ * Take the next index of our own range
+ */
+static bool take_own(square_pool_t *pool, unsigned id, size_t *index) {
+	worker_range_t *range = &pool->ranges[id];
+	bool found = false;
+
+	pthread_mutex_lock(&range->lock);
+	if (range->lo < range->hi) {
+		*index = range->lo++;
+		found = true;
+	}
+	pthread_mutex_unlock(&range->lock);
+	return found;
+}
+
+/*
+ * Move the back half of the largest other range into ours
+ */
+static bool steal(square_pool_t *pool, unsigned id) {
+	for (;;) {
+		unsigned victim = id;
+		size_t best = 0;
+
+		// The sizes are only a hint, they may change right after the scan
+		for (unsigned i = 0; i < pool->size; ++i) {
+			worker_range_t *range = &pool->ranges[i];
+			if (i == id) {
+				continue;
+			}
+			pthread_mutex_lock(&range->lock);
+			size_t left = range->hi - range->lo;
+			pthread_mutex_unlock(&range->lock);
+			if (left > best) {
+				best = left;
+				victim = i;
+			}
+		}
+		if (victim == id) {
+			return false;
+		}
+
+		worker_range_t *from = &pool->ranges[victim];
+		size_t lo = 0, hi = 0;
+		pthread_mutex_lock(&from->lock);
+		if (from->lo < from->hi) {
+			size_t half = (from->hi - from->lo + 1) / 2;
+			hi = from->hi;
+			lo = hi - half;
+			from->hi = lo;
+		}
+		pthread_mutex_unlock(&from->lock);
+
+		if (lo < hi) {
+			worker_range_t *own = &pool->ranges[id];
+			pthread_mutex_lock(&own->lock);
+			own->lo = lo;
+			own->hi = hi;
+			pthread_mutex_unlock(&own->lock);
+			return true;
+		}
+		// Lost the race for that range, rescan
+	}
+}
+
+static void run_tasks(square_pool_t *pool, unsigned id) {
+	size_t index;
+
+	for (;;) {
+		if (take_own(pool, id, &index)) {
+			pool->fn(pool->arg, index, id);
+		} else if (!steal(pool, id)) {
+			// Ranges only shrink during a job: nothing left anywhere
+			return;
+		}
+	}
+}
+
+static void *worker_main(void *p) {
+	worker_arg_t *warg = p;
+	square_pool_t *pool = warg->pool;
+	uint64_t seen = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && pool->generation == seen) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		run_tasks(pool, warg->id);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->running == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+square_pool_t *square_pool_create(unsigned nthreads) {
+	square_pool_t *pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+
+	pool->size = nthreads ? nthreads : square_cpu_count();
+	pool->threads = calloc(pool->size, sizeof(*pool->threads));
+	pool->args = calloc(pool->size, sizeof(*pool->args));
+	pool->ranges = calloc(pool->size, sizeof(*pool->ranges));
+	if (!pool->threads || !pool->args || !pool->ranges) {
+		free(pool->threads);
+		free(pool->args);
+		free(pool->ranges);
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (unsigned i = 0; i < pool->size; ++i) {
+		pthread_mutex_init(&pool->ranges[i].lock, NULL);
+		pool->args[i].pool = pool;
+		pool->args[i].id = i;
+	}
+
+	// Worker 0 is the caller of square_pool_parallel_for
+	for (unsigned i = 1; i < pool->size; ++i) {
+		if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) {
+			// Run with the workers we got
+			pool->size = i;
+			break;
+		}
+	}
+	return pool;
+}
+
+void square_pool_destroy(square_pool_t *pool) {
+	if (!pool) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (unsigned i = 1; i < pool->size; ++i) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	for (unsigned i = 0; i < pool->size; ++i) {
+		pthread_mutex_destroy(&pool->ranges[i].lock);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	free(pool->threads);
+	free(pool->args);
+	free(pool->ranges);
+	free(pool);
+}
+
+unsigned square_pool_size(const square_pool_t *pool) {
+	return pool->size;
+}
+
+void square_pool_parallel_for(square_pool_t *pool, size_t count,
+							  square_task_fn fn, void *arg) {
+	if (count == 0) {
+		return;
+	}
+	if (pool->size == 1 || count == 1) {
+		for (size_t i = 0; i < count; ++i) {
+			fn(arg, i, 0);
+		}
+		return;
+	}
+
+	// Contiguous initial split, stealing evens out the imbalance
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->arg = arg;
+	for (unsigned i = 0; i < pool->size; ++i) {
+		worker_range_t *range = &pool->ranges[i];
+		pthread_mutex_lock(&range->lock);
+		range->lo = count * i / pool->size;
+		range->hi = count * (i + 1) / pool->size;
+		pthread_mutex_unlock(&range->lock);
+	}
+	pool->running = pool->size - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_tasks(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->running > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,43 @@
+#ifndef SQUARE_POOL_H
+#define SQUARE_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Work-stealing thread pool
+ * =========================
+ * Each worker owns a range of task indices. It consumes its own range from
+ * the front and, once empty, steals half of the largest remaining range of
+ * another worker from the back. The calling thread runs as worker 0.
+ */
+
+typedef struct square_pool square_pool_t;
+
+/*
+ * Task body: @index in [0, count), @worker in [0, square_pool_size()).
+ * Per-worker state indexed by @worker needs no locking.
+ */
+typedef void (*square_task_fn)(void *arg, size_t index, unsigned worker);
+
+/*
+ * Create a pool of @nthreads workers, the caller included.
+ * @nthreads == 0 uses one worker per online CPU.
+ */
+square_pool_t *square_pool_create(unsigned nthreads);
+void square_pool_destroy(square_pool_t *pool);
+
+unsigned square_pool_size(const square_pool_t *pool);
+
+/*
+ * Run @fn for every index in [0, @count) and wait for all of them.
+ * Not reentrant: tasks must not call square_pool_parallel_for.
+ */
+void square_pool_parallel_for(square_pool_t *pool, size_t count,
+                              square_task_fn fn, void *arg);
+
+/*
+ * Number of online CPUs, at least 1
+ */
+unsigned square_cpu_count(void);
+
+#endif // SQUARE_POOL_H
@@ -0,0 +1,170 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "square_psum.h"
+#include "aes-128_enc.h"
+#include "square_gf.h"
+
+// Stage s + 1 is reduced once it has at least domain / 2^PSUM_DENSITY_SHIFT
+// entries: below that, duplicates are too rare to pay for the pass
+#define PSUM_DENSITY_SHIFT 6
+// Widest stage domain that is ever reduced, (a, c_2, c_3)
+#define PSUM_REDUCE_BITS 24
+
+void psum_tables_init(psum_tables_t *tables, const uint8_t multipliers[PSUM_STAGES]) {
+	const gf_field_t *field = gf_aes_field();
+
+	for (int j = 0; j < PSUM_STAGES; ++j) {
+		gf_mul_const_many(field, multipliers[j], Sinv, tables->table[j], 256);
+	}
+}
+
+/*
+ * Bits of the domain of stage @stage: a plus the bytes still to guess
+ */
+static unsigned domain_bits(unsigned stage) {
+	return 8 * (PSUM_STAGES + 1 - stage);
+}
+
+static size_t reduce_threshold(unsigned stage) {
+	return (size_t)1 << (domain_bits(stage) - PSUM_DENSITY_SHIFT);
+}
+
+int psum_init(psum_t *ps, const psum_tables_t *tables, size_t capacity) {
+	memset(ps, 0, sizeof(*ps));
+	ps->tables = tables;
+	ps->capacity = capacity;
+
+	for (unsigned stage = 1; stage < PSUM_STAGES; ++stage) {
+		// The partial sum, plus the c_j planes a reduction rewrites
+		bool reduced = domain_bits(stage) <= PSUM_REDUCE_BITS &&
+			capacity >= reduce_threshold(stage);
+		for (unsigned j = 0; j < PSUM_STAGES; ++j) {
+			if (j == 0 || (reduced && j >= stage)) {
+				ps->planes[stage][j] = malloc(capacity);
+				if (!ps->planes[stage][j]) {
+					psum_free(ps);
+					return -1;
+				}
+			}
+		}
+		if (reduced && !ps->bitmap) {
+			ps->bitmap = calloc(((size_t)1 << domain_bits(stage)) / 64, sizeof(uint64_t));
+			if (!ps->bitmap) {
+				psum_free(ps);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+void psum_free(psum_t *ps) {
+	for (unsigned stage = 0; stage < PSUM_STAGES; ++stage) {
+		for (unsigned j = 0; j < PSUM_STAGES; ++j) {
+			free(ps->planes[stage][j]);
+			ps->planes[stage][j] = NULL;
+		}
+	}
+	free(ps->bitmap);
+	ps->bitmap = NULL;
+}
+
+void psum_load(psum_t *ps, const uint8_t *const c[PSUM_STAGES], size_t count) {
+	psum_stage_t *in = &ps->stages[0];
+
+	in->count = count < ps->capacity ? count : ps->capacity;
+	in->a = NULL;
+	for (unsigned j = 0; j < PSUM_STAGES; ++j) {
+		in->c[j] = c[j];
+	}
+}
+
+static inline uint32_t stage_key(const psum_stage_t *stage, unsigned first, size_t n) {
+	uint32_t key = stage->a[n];
+	for (unsigned j = first; j < PSUM_STAGES; ++j) {
+		key |= (uint32_t)stage->c[j][n] << (8 * (j - first + 1));
+	}
+	return key;
+}
+
+/*
+ * Keep one copy of every entry of stage @index occurring an odd number of
+ * times, writing the c_j planes into the stage's own storage
+ */
+static void reduce_stage(psum_t *ps, unsigned index) {
+	psum_stage_t *stage = &ps->stages[index];
+	uint64_t *bitmap = ps->bitmap;
+	uint8_t *a = ps->planes[index][0];
+	size_t kept = 0;
+
+	for (size_t n = 0; n < stage->count; ++n) {
+		uint32_t key = stage_key(stage, index, n);
+		bitmap[key >> 6] ^= (uint64_t)1 << (key & 63);
+	}
+	// The first copy of an odd entry finds its bit set and clears it, so
+	// the bitmap is all zero again afterwards
+	for (size_t n = 0; n < stage->count; ++n) {
+		uint32_t key = stage_key(stage, index, n);
+		uint64_t bit = (uint64_t)1 << (key & 63);
+		if (!(bitmap[key >> 6] & bit)) {
+			continue;
+		}
+		bitmap[key >> 6] &= ~bit;
+		for (unsigned j = index; j < PSUM_STAGES; ++j) {
+			ps->planes[index][j][kept] = stage->c[j][n];
+		}
+		a[kept++] = stage->a[n];
+	}
+
+	stage->count = kept;
+	for (unsigned j = index; j < PSUM_STAGES; ++j) {
+		stage->c[j] = ps->planes[index][j];
+	}
+}
+
+void psum_guess(psum_t *ps, unsigned stage, uint8_t key_byte) {
+	const psum_stage_t *in = &ps->stages[stage];
+	const uint8_t *table = ps->tables->table[stage];
+	const uint8_t *c = in->c[stage];
+
+	if (stage == PSUM_STAGES - 1) {
+		column_parity_t *parity = &ps->parity;
+		memset(parity->parity, 0, sizeof(parity->parity));
+		for (size_t n = 0; n < in->count; ++n) {
+			uint8_t z = in->a[n] ^ table[c[n] ^ key_byte];
+			parity->parity[z >> 6] ^= (uint64_t)1 << (z & 63);
+		}
+		parity->count = 0;
+		for (int w = 0; w < 4; ++w) {
+			uint64_t bits = parity->parity[w];
+			while (bits) {
+				parity->values[parity->count++] = (uint8_t)(64 * w + __builtin_ctzll(bits));
+				bits &= bits - 1;
+			}
+		}
+		return;
+	}
+
+	psum_stage_t *out = &ps->stages[stage + 1];
+	uint8_t *a = ps->planes[stage + 1][0];
+	if (in->a) {
+		for (size_t n = 0; n < in->count; ++n) {
+			a[n] = in->a[n] ^ table[c[n] ^ key_byte];
+		}
+	} else {
+		for (size_t n = 0; n < in->count; ++n) {
+			a[n] = table[c[n] ^ key_byte];
+		}
+	}
+	out->count = in->count;
+	out->a = a;
+	for (unsigned j = stage + 1; j < PSUM_STAGES; ++j) {
+		out->c[j] = in->c[j];
+	}
+
+	if (ps->planes[stage + 1][PSUM_STAGES - 1] && out->count >= reduce_threshold(stage + 1)) {
+		reduce_stage(ps, stage + 1);
+	}
+}
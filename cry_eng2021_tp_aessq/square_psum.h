@@ -0,0 +1,79 @@
+#ifndef SQUARE_PSUM_H
+#define SQUARE_PSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "square_guess.h"
+
+/*
+ * Partial sums
+ * ============
+ * Ferguson et al.'s evaluation of a sum over texts of
+ *
+ *   z = T_0[c_0 ^ k_0] ^ T_1[c_1 ^ k_1] ^ T_2[c_2 ^ k_2] ^ T_3[c_3 ^ k_3],
+ *   T_j[v] = m_j * Sinv[v]
+ *
+ * one key byte at a time. Stage s holds the texts as (a, c_s, ..., c_3)
+ * with a = the sum of the terms already guessed, a list over a domain of
+ * 2^(8 (5 - s)) values. Only the parity of each value's multiplicity
+ * matters, so large stages are reduced to their odd entries, and the last
+ * stage is the column_parity_t of z the key-guess engine scores directly.
+ * Each stage is computed once for every value of its key byte and shared
+ * by all the guesses below it. Entries are stored byte-plane by byte-plane
+ * so every stage is a streaming pass.
+ */
+
+#define PSUM_STAGES 4
+
+// T_j for one choice of multipliers m_j, shared read-only
+typedef struct {
+	uint8_t table[PSUM_STAGES][256];
+} psum_tables_t;
+
+typedef struct {
+	size_t count;
+	const uint8_t *a;                   // partial sum, NULL at stage 0
+	const uint8_t *c[PSUM_STAGES];      // c[j] valid for j >= stage
+} psum_stage_t;
+
+typedef struct {
+	const psum_tables_t *tables;
+	size_t capacity;
+	psum_stage_t stages[PSUM_STAGES];
+	// Storage of stages 1..3: the partial sum, and c_j copies once reduced
+	uint8_t *planes[PSUM_STAGES][PSUM_STAGES];
+	uint64_t *bitmap;                   // parity scratch of the reductions
+	column_parity_t parity;             // z after the last key byte
+} psum_t;
+
+/*
+ * T_j[v] = @multipliers[j] * Sinv[v] in GF(2^8)
+ */
+void psum_tables_init(psum_tables_t *tables, const uint8_t multipliers[PSUM_STAGES]);
+
+/*
+ * Room for up to @capacity texts. Returns 0 or -1.
+ */
+int psum_init(psum_t *ps, const psum_tables_t *tables, size_t capacity);
+void psum_free(psum_t *ps);
+
+/*
+ * Stage 0: @count texts given by their 4 byte planes, kept by reference
+ */
+void psum_load(psum_t *ps, const uint8_t *const c[PSUM_STAGES], size_t count);
+
+/*
+ * Guess @key_byte for byte @stage: compute stage @stage + 1 from stage
+ * @stage, or the parity of z when @stage is the last one
+ */
+void psum_guess(psum_t *ps, unsigned stage, uint8_t key_byte);
+
+/*
+ * Parity of z after psum_guess(ps, PSUM_STAGES - 1, ...)
+ */
+static inline const column_parity_t *psum_parity(const psum_t *ps) {
+	return &ps->parity;
+}
+
+#endif // SQUARE_PSUM_H
@@ -0,0 +1,157 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+#include "square_random.h"
+#include "aes-128_engine.h"
+
+// Blocks per refill, the first one rekeys the generator
+#define RANDOM_BUFFER_BLOCKS 64
+// Largest request written straight to the caller's buffer in one pass
+#define RANDOM_DIRECT_BLOCKS 4096
+
+typedef struct {
+	aes128_key_schedule_t ks;
+	uint8_t buffer[RANDOM_BUFFER_BLOCKS][AES_BLOCK_SIZE];
+	size_t available;       // unread bytes at the end of buffer
+	uint64_t counter;
+	uint64_t generation;    // random_generation the key was drawn in
+} drbg_t;
+
+static _Thread_local drbg_t drbg;
+
+// Bumped to make every thread rekey: new seed mode, or after fork
+static uint64_t random_generation = 1;
+static bool seeded_mode;
+static uint64_t seed_value;
+static uint64_t seed_ordinal;   // threads keyed from the seed so far
+
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void rekey_after_fork(void) {
+	__atomic_fetch_add(&random_generation, 1, __ATOMIC_RELAXED);
+}
+
+static void register_atfork(void) {
+	pthread_atfork(NULL, NULL, rekey_after_fork);
+}
+
+static int os_entropy(uint8_t *buffer, size_t length) {
+	while (length > 0) {
+		ssize_t got = getrandom(buffer, length, 0);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		buffer += got;
+		length -= (size_t)got;
+	}
+	if (length == 0) {
+		return 0;
+	}
+
+	// Kernels without getrandom()
+	int fd = open("/dev/urandom", O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	ssize_t got = read(fd, buffer, length);
+	close(fd);
+	return got == (ssize_t)length ? 0 : -1;
+}
+
+static int drbg_seed(uint64_t generation) {
+	uint8_t key[AES_128_KEY_SIZE];
+
+	if (__atomic_load_n(&seeded_mode, __ATOMIC_RELAXED)) {
+		// Key k_i = AES_seed(i) for the i-th thread to draw
+		uint8_t seed_key[AES_128_KEY_SIZE] = {0};
+		uint64_t ordinal = __atomic_fetch_add(&seed_ordinal, 1, __ATOMIC_RELAXED);
+		memcpy(seed_key, &seed_value, sizeof(seed_value));
+		memset(key, 0, sizeof(key));
+		memcpy(key, &ordinal, sizeof(ordinal));
+		aes128_enc(key, seed_key, AES128_MAX_ROUNDS, 0);
+	} else if (os_entropy(key, sizeof(key)) != 0) {
+		return -1;
+	}
+
+	aes128_expand_key(&drbg.ks, key);
+	memset(key, 0, sizeof(key));
+	drbg.counter = 0;
+	drbg.available = 0;
+	drbg.generation = generation;
+	return 0;
+}
+
+/*
+ * Encrypt @nblocks counter blocks into @blocks
+ */
+static void drbg_generate(uint8_t blocks[][AES_BLOCK_SIZE], size_t nblocks) {
+	for (size_t i = 0; i < nblocks; ++i) {
+		memset(blocks[i], 0, AES_BLOCK_SIZE);
+		memcpy(blocks[i], &drbg.counter, sizeof(drbg.counter));
+		drbg.counter++;
+	}
+	aes128_enc_many_ks(blocks, nblocks, &drbg.ks, AES128_MAX_ROUNDS, 0);
+}
+
+static void drbg_refill(void) {
+	drbg_generate(drbg.buffer, RANDOM_BUFFER_BLOCKS);
+	aes128_expand_key(&drbg.ks, drbg.buffer[0]);
+	memset(drbg.buffer[0], 0, AES_BLOCK_SIZE);
+	drbg.counter = 0;
+	drbg.available = (RANDOM_BUFFER_BLOCKS - 1) * AES_BLOCK_SIZE;
+}
+
+int square_random_fill(uint8_t *buffer, size_t length) {
+	pthread_once(&atfork_once, register_atfork);
+	uint64_t generation = __atomic_load_n(&random_generation, __ATOMIC_RELAXED);
+	if (drbg.generation != generation && drbg_seed(generation) != 0) {
+		return -1;
+	}
+
+	// Bulk requests: whole blocks straight into @buffer, then rekey
+	if (length >= sizeof(drbg.buffer)) {
+		while (length >= AES_BLOCK_SIZE) {
+			size_t nblocks = length / AES_BLOCK_SIZE;
+			nblocks = nblocks < RANDOM_DIRECT_BLOCKS ? nblocks : RANDOM_DIRECT_BLOCKS;
+			drbg_generate((uint8_t (*)[AES_BLOCK_SIZE])buffer, nblocks);
+			buffer += nblocks * AES_BLOCK_SIZE;
+			length -= nblocks * AES_BLOCK_SIZE;
+		}
+		drbg_refill();
+	}
+
+	while (length > 0) {
+		if (drbg.available == 0) {
+			drbg_refill();
+		}
+		size_t chunk = length < drbg.available ? length : drbg.available;
+		uint8_t *end = drbg.buffer[0] + sizeof(drbg.buffer);
+		memcpy(buffer, end - drbg.available, chunk);
+		// Bytes handed out are not kept
+		memset(end - drbg.available, 0, chunk);
+		drbg.available -= chunk;
+		buffer += chunk;
+		length -= chunk;
+	}
+	return 0;
+}
+
+void square_random_use_seed(uint64_t seed) {
+	seed_value = seed;
+	seed_ordinal = 0;
+	__atomic_store_n(&seeded_mode, true, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&random_generation, 1, __ATOMIC_RELAXED);
+}
+
+void square_random_use_os(void) {
+	__atomic_store_n(&seeded_mode, false, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&random_generation, 1, __ATOMIC_RELAXED);
+}
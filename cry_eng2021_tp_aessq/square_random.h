@@ -0,0 +1,35 @@
+#ifndef SQUARE_RANDOM_H
+#define SQUARE_RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Random generator
+ * ================
+ * One AES-128-CTR generator per thread, keyed once from getrandom() and
+ * drawn from a buffer refilled RANDOM_BUFFER_BLOCKS blocks at a time. The
+ * first block of every refill becomes the next key, so earlier output
+ * cannot be recomputed from the state. A forked child rekeys before its
+ * first draw.
+ */
+
+/*
+ * Fill @buffer with @length random bytes. Returns 0, or -1 if the
+ * generator could not be seeded.
+ */
+int square_random_fill(uint8_t *buffer, size_t length);
+
+/*
+ * Deterministic mode for reproducible benchmarks: every thread rekeys
+ * from @seed and the order in which it first draws. Single-threaded runs
+ * repeat exactly. Call before starting threads.
+ */
+void square_random_use_seed(uint64_t seed);
+
+/*
+ * Back to getrandom() keys, the default
+ */
+void square_random_use_os(void);
+
+#endif // SQUARE_RANDOM_H
@@ -0,0 +1,286 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "square_spn.h"
+#include "square_crypto.h"
+
+static uint8_t rotl8(uint8_t x, unsigned n) {
+	return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+/*
+ * Determinant of the @size x @size submatrix of the circulant with first
+ * row @row on rows @rows and columns @cols, by elimination
+ */
+static uint8_t minor(const gf_field_t *field, const uint8_t row[4],
+					 const int *rows, const int *cols, int size) {
+	uint8_t m[4][4];
+	uint8_t det = 1;
+
+	for (int i = 0; i < size; ++i) {
+		for (int j = 0; j < size; ++j) {
+			m[i][j] = row[(cols[j] - rows[i]) & 3];
+		}
+	}
+	for (int col = 0; col < size; ++col) {
+		int pivot = col;
+		while (pivot < size && m[pivot][col] == 0) {
+			pivot++;
+		}
+		if (pivot == size) {
+			return 0;
+		}
+		if (pivot != col) {
+			uint8_t tmp[4];
+			memcpy(tmp, m[col], sizeof(tmp));
+			memcpy(m[col], m[pivot], sizeof(tmp));
+			memcpy(m[pivot], tmp, sizeof(tmp));
+		}
+		det = gf_mul(field, det, m[col][col]);
+		uint8_t scale = gf_inverse(field, m[col][col]);
+		for (int r = col + 1; r < size; ++r) {
+			uint8_t factor = gf_mul(field, m[r][col], scale);
+			for (int j = col; j < size; ++j) {
+				m[r][j] ^= gf_mul(field, factor, m[col][j]);
+			}
+		}
+	}
+	return det;
+}
+
+/*
+ * MDS iff every square submatrix is nonsingular
+ */
+static bool mix_is_mds(const gf_field_t *field, const uint8_t row[4]) {
+	for (unsigned row_mask = 1; row_mask < 16; ++row_mask) {
+		for (unsigned col_mask = 1; col_mask < 16; ++col_mask) {
+			int rows[4], cols[4], nrows = 0, ncols = 0;
+			if (__builtin_popcount(row_mask) != __builtin_popcount(col_mask)) {
+				continue;
+			}
+			for (int i = 0; i < 4; ++i) {
+				if (row_mask & (1u << i)) {
+					rows[nrows++] = i;
+				}
+				if (col_mask & (1u << i)) {
+					cols[ncols++] = i;
+				}
+			}
+			if (minor(field, row, rows, cols, nrows) == 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int spn_init(spn_cipher_t *cipher, const spn_params_t *params) {
+	uint16_t polynomial = params->polynomial ? params->polynomial : GF_AES_POLYNOMIAL;
+	const gf_field_t *field = &cipher->field;
+
+	if (gf_field_init(&cipher->field, polynomial) != 0) {
+		return -1;
+	}
+
+	if (params->sbox) {
+		memcpy(cipher->sbox, params->sbox, sizeof(cipher->sbox));
+	} else {
+		for (unsigned x = 0; x < 256; ++x) {
+			uint8_t b = gf_inverse(field, (uint8_t)x);
+			cipher->sbox[x] = b ^ rotl8(b, 1) ^ rotl8(b, 2) ^ rotl8(b, 3) ^ rotl8(b, 4) ^ 0x63;
+		}
+	}
+	bool seen[256] = {false};
+	for (unsigned x = 0; x < 256; ++x) {
+		if (seen[cipher->sbox[x]]) {
+			return -1;
+		}
+		seen[cipher->sbox[x]] = true;
+		cipher->sbox_inv[cipher->sbox[x]] = (uint8_t)x;
+	}
+
+	// gf_field_init set the field's mix to the AES row
+	memcpy(cipher->mix, params->mix ? params->mix : field->mix, sizeof(cipher->mix));
+	if (gf_circulant_inverse(field, cipher->mix, cipher->inv_mix) != 0) {
+		return -1;
+	}
+	cipher->mds = mix_is_mds(field, cipher->mix);
+
+	cipher->rcon[0] = 1;
+	for (int i = 1; i < AES128_MAX_ROUNDS; ++i) {
+		cipher->rcon[i] = gf_mul(field, cipher->rcon[i - 1], 0x02);
+	}
+
+	// Input row j reaches output row r through mix[(j - r) & 3]
+	for (unsigned x = 0; x < 256; ++x) {
+		for (int j = 0; j < 4; ++j) {
+			uint32_t word = 0;
+			for (int r = 0; r < 4; ++r) {
+				word |= (uint32_t)gf_mul(field, cipher->mix[(j - r) & 3], cipher->sbox[x]) << (8 * r);
+			}
+			cipher->te[j][x] = word;
+		}
+	}
+	return 0;
+}
+
+int spn_random_sbox(uint8_t sbox[256]) {
+	uint16_t noise[256];
+
+	if (!secure_random_bytes((uint8_t *)noise, sizeof(noise))) {
+		return -1;
+	}
+	for (unsigned i = 0; i < 256; ++i) {
+		sbox[i] = (uint8_t)i;
+	}
+	// Fisher-Yates, 16 random bits per draw: the modulo bias is below 2^-8
+	for (unsigned i = 255; i > 0; --i) {
+		unsigned j = noise[i] % (i + 1);
+		uint8_t tmp = sbox[i];
+		sbox[i] = sbox[j];
+		sbox[j] = tmp;
+	}
+	return 0;
+}
+
+int spn_random_polynomial(uint16_t *polynomial) {
+	for (;;) {
+		uint8_t low;
+		if (!secure_random_bytes(&low, 1)) {
+			return -1;
+		}
+		if (gf_irreducible(0x100 | low)) {
+			*polynomial = 0x100 | low;
+			return 0;
+		}
+	}
+}
+
+int spn_random_mix(const gf_field_t *field, bool mds, uint8_t row[4]) {
+	uint8_t inverse[4];
+
+	// Rejection: almost every random row is invertible, and 94% of those are MDS
+	do {
+		if (!secure_random_bytes(row, 4)) {
+			return -1;
+		}
+	} while (gf_circulant_inverse(field, row, inverse) != 0 ||
+			 (mds && !mix_is_mds(field, row)));
+	return 0;
+}
+
+static spn_cipher_t aes_cipher;
+static pthread_once_t aes_once = PTHREAD_ONCE_INIT;
+
+static void aes_init(void) {
+	spn_init(&aes_cipher, &(spn_params_t){0});
+}
+
+const spn_cipher_t *spn_aes(void) {
+	pthread_once(&aes_once, aes_init);
+	return &aes_cipher;
+}
+
+void spn_expand_key(const spn_cipher_t *cipher, aes128_key_schedule_t *ks,
+					const uint8_t key[AES_128_KEY_SIZE]) {
+	const uint8_t *S = cipher->sbox;
+
+	memcpy(ks->rk[0], key, AES_128_KEY_SIZE);
+	for (int round = 0; round < AES128_MAX_ROUNDS; ++round) {
+		const uint8_t *prev = ks->rk[round];
+		uint8_t *next = ks->rk[round + 1];
+
+		next[0] = prev[0] ^ S[prev[13]] ^ cipher->rcon[round];
+		next[1] = prev[1] ^ S[prev[14]];
+		next[2] = prev[2] ^ S[prev[15]];
+		next[3] = prev[3] ^ S[prev[12]];
+		for (int i = 4; i < AES_128_KEY_SIZE; ++i) {
+			next[i] = prev[i] ^ next[i - 4];
+		}
+	}
+}
+
+void spn_prev_round_key(const spn_cipher_t *cipher, const uint8_t next_key[AES_BLOCK_SIZE],
+						uint8_t prev_key[AES_BLOCK_SIZE], int round) {
+	const uint8_t *S = cipher->sbox;
+
+	for (int i = 4; i < AES_BLOCK_SIZE; ++i) {
+		prev_key[i] = next_key[i] ^ next_key[i - 4];
+	}
+	prev_key[0] = next_key[0] ^ S[prev_key[13]] ^ cipher->rcon[round];
+	prev_key[1] = next_key[1] ^ S[prev_key[14]];
+	prev_key[2] = next_key[2] ^ S[prev_key[15]];
+	prev_key[3] = next_key[3] ^ S[prev_key[12]];
+}
+
+static uint32_t load32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store32(uint8_t *p, uint32_t w) {
+	p[0] = (uint8_t)w;
+	p[1] = (uint8_t)(w >> 8);
+	p[2] = (uint8_t)(w >> 16);
+	p[3] = (uint8_t)(w >> 24);
+}
+
+// SubBytes + ShiftRows of output column @c, without MixColumns
+#define SHIFT_SUB(S, a, b, c, d) \
+	((uint32_t)S[(a) & 0xff] | ((uint32_t)S[((b) >> 8) & 0xff] << 8) | \
+	 ((uint32_t)S[((c) >> 16) & 0xff] << 16) | ((uint32_t)S[(d) >> 24] << 24))
+
+// Same round structure as the T-table backend, columns as little-endian words
+void spn_enc_many_ks(const spn_cipher_t *cipher, uint8_t blocks[][AES_BLOCK_SIZE],
+					 size_t nblocks, const aes128_key_schedule_t *ks,
+					 unsigned nrounds, int lastfull) {
+	const uint32_t (*te)[256] = cipher->te;
+	const uint8_t *S = cipher->sbox;
+	uint32_t w[AES128_MAX_ROUNDS + 1][4];
+
+	// Like aes128_enc_many_ks, at least one round
+	if (nrounds == 0) {
+		nrounds = 1;
+	}
+	unsigned mid = lastfull ? nrounds : nrounds - 1;
+
+	for (unsigned r = 0; r <= nrounds; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			w[r][c] = load32(ks->rk[r] + 4 * c);
+		}
+	}
+
+	for (size_t n = 0; n < nblocks; ++n) {
+		uint8_t *block = blocks[n];
+		uint32_t s0 = load32(block) ^ w[0][0];
+		uint32_t s1 = load32(block + 4) ^ w[0][1];
+		uint32_t s2 = load32(block + 8) ^ w[0][2];
+		uint32_t s3 = load32(block + 12) ^ w[0][3];
+		uint32_t t0, t1, t2, t3;
+
+		for (unsigned r = 1; r <= mid; ++r) {
+			t0 = te[0][s0 & 0xff] ^ te[1][(s1 >> 8) & 0xff] ^ te[2][(s2 >> 16) & 0xff] ^ te[3][s3 >> 24] ^ w[r][0];
+			t1 = te[0][s1 & 0xff] ^ te[1][(s2 >> 8) & 0xff] ^ te[2][(s3 >> 16) & 0xff] ^ te[3][s0 >> 24] ^ w[r][1];
+			t2 = te[0][s2 & 0xff] ^ te[1][(s3 >> 8) & 0xff] ^ te[2][(s0 >> 16) & 0xff] ^ te[3][s1 >> 24] ^ w[r][2];
+			t3 = te[0][s3 & 0xff] ^ te[1][(s0 >> 8) & 0xff] ^ te[2][(s1 >> 16) & 0xff] ^ te[3][s2 >> 24] ^ w[r][3];
+			s0 = t0;
+			s1 = t1;
+			s2 = t2;
+			s3 = t3;
+		}
+		if (!lastfull) {
+			t0 = SHIFT_SUB(S, s0, s1, s2, s3) ^ w[nrounds][0];
+			t1 = SHIFT_SUB(S, s1, s2, s3, s0) ^ w[nrounds][1];
+			t2 = SHIFT_SUB(S, s2, s3, s0, s1) ^ w[nrounds][2];
+			t3 = SHIFT_SUB(S, s3, s0, s1, s2) ^ w[nrounds][3];
+			s0 = t0;
+			s1 = t1;
+			s2 = t2;
+			s3 = t3;
+		}
+
+		store32(block, s0);
+		store32(block + 4, s1);
+		store32(block + 8, s2);
+		store32(block + 12, s3);
+	}
+}
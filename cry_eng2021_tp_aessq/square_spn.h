@@ -0,0 +1,87 @@
+#ifndef SQUARE_SPN_H
+#define SQUARE_SPN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes-128_enc.h"
+#include "square_gf.h"
+
+/*
+ * Parameterized AES-like cipher
+ * =============================
+ * AES-128 with its S-box, field polynomial and MixColumns matrix made
+ * parameters: same state layout, ShiftRows and key schedule, with the
+ * round constants x^i and the mixing layer computed in the chosen field.
+ * spn_init generates every table once (S-box, inverse, T-tables, round
+ * constants), after which a variant encrypts as fast as the T-table
+ * backend. The AES parameters give back AES exactly.
+ */
+
+typedef struct {
+	uint16_t polynomial;      // reduction polynomial, 0 for GF_AES_POLYNOMIAL
+	const uint8_t *sbox;      // 256 bytes, NULL for the AES construction in this field
+	const uint8_t *mix;       // first row of the circulant MixColumns, NULL for {02, 03, 01, 01}
+} spn_params_t;
+
+typedef struct spn_cipher {
+	gf_field_t field;
+	uint8_t sbox[256];
+	uint8_t sbox_inv[256];
+	uint8_t mix[4];
+	uint8_t inv_mix[4];
+	uint8_t rcon[AES128_MAX_ROUNDS];
+	uint32_t te[4][256];      // te[r][x]: S[x] in row r through MixColumns
+	bool mds;                 // the mixing layer has branch number 5
+} spn_cipher_t;
+
+/*
+ * Build the tables of the variant @params. The default S-box is the AES
+ * one, x^-1 then the AES affine map, computed in the chosen field.
+ * Returns 0, or -1 if the polynomial is reducible, the S-box is not a
+ * permutation or the mixing layer is not invertible.
+ */
+int spn_init(spn_cipher_t *cipher, const spn_params_t *params);
+
+/*
+ * AES itself, built on first use
+ */
+const spn_cipher_t *spn_aes(void);
+
+/*
+ * Random variant parameters, from secure_random_bytes. Each returns 0, or
+ * -1 if no randomness is available.
+ * spn_random_sbox: uniform permutation of the 256 bytes
+ * spn_random_polynomial: uniform over the 30 irreducible polynomials
+ * spn_random_mix: uniform invertible circulant row over @field, MDS if @mds
+ */
+int spn_random_sbox(uint8_t sbox[256]);
+int spn_random_polynomial(uint16_t *polynomial);
+int spn_random_mix(const gf_field_t *field, bool mds, uint8_t row[4]);
+
+/*
+ * Round keys 0...10 of @key, same schedule as aes128_expand_key with
+ * the variant's S-box and round constants
+ */
+void spn_expand_key(const spn_cipher_t *cipher, aes128_key_schedule_t *ks,
+                    const uint8_t key[AES_128_KEY_SIZE]);
+
+/*
+ * Compute the @round-th round key in @prev_key, given the @(round + 1)-th
+ * key in @next_key. @round in {0...9}
+ */
+void spn_prev_round_key(const spn_cipher_t *cipher, const uint8_t next_key[AES_BLOCK_SIZE],
+                        uint8_t prev_key[AES_BLOCK_SIZE], int round);
+
+/*
+ * Same contract as aes128_enc_many_ks: encrypt the @nblocks blocks of
+ * @blocks in place over @nrounds, the last one with MixColumns if
+ * @lastfull. @nrounds <= 10, 0 runs one round.
+ * NOT constant-time: table indices depend on the state.
+ */
+void spn_enc_many_ks(const spn_cipher_t *cipher, uint8_t blocks[][AES_BLOCK_SIZE],
+                     size_t nblocks, const aes128_key_schedule_t *ks,
+                     unsigned nrounds, int lastfull);
+
+#endif // SQUARE_SPN_H
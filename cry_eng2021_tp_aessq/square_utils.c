@@ -1,26 +1,14 @@
 #include "square_crypto.h"
+#include "square_random.h"
 #include <stdlib.h>
 #include <string.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <sys/time.h>
 
 bool secure_random_bytes(uint8_t* buffer, size_t length) {
     if (!buffer || length == 0) return false;
-    
-    int entropy_fd = open("/dev/urandom", O_RDONLY);
-    if (entropy_fd < 0) {
-        // Fallback to time-based seeding
-        srand((unsigned int)time(NULL));
-        for (size_t i = 0; i < length; i++) {
-            buffer[i] = (uint8_t)(rand() & 0xFF);
-        }
-        return true;
-    }
-    
-    ssize_t bytes_read = read(entropy_fd, buffer, length);
-    close(entropy_fd);
-    return (bytes_read == (ssize_t)length);
+
+    // Per-thread AES-CTR generator, no syscall once seeded
+    return square_random_fill(buffer, length) == 0;
 }
 
 void format_hex_output(const uint8_t* data, size_t length, const char* label) {